@@ -0,0 +1,490 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file implements adaptive huffman coding with the FGK
+        algorithm. After a symbol is coded, its leaf and every ancestor
+        gain one, and each node first trades places with the highest
+        numbered node of equal weight, which keeps the nodes ordered by
+        weight. Input and output go through fixed size buffers.
+
+ */
+#include "adaptive.h"
+#include "format.h"
+#include "stats.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/** Bytes read or written at a time */
+#define STREAM_CHUNK (1 << 16)
+/** Room for one more code after the output buffer is full */
+#define STREAM_SLACK (ADAPTIVE_NODES / 8 + 16)
+
+/**
+Resets a tree to the NYT node alone
+@param tree is the tree to reset
+*/
+void initAdaptiveTree(adaptiveTree *tree) {
+  for (int symbol = 0; symbol < ADAPTIVE_SYMBOLS; symbol++) {
+    tree->leaf[symbol] = -1;
+  }
+  tree->root = ADAPTIVE_NODES - 1;
+  tree->nyt = tree->root;
+  adaptiveNode *root = &tree->nodes[tree->root];
+  root->weight = 0;
+  root->parent = -1;
+  root->left = -1;
+  root->right = -1;
+  root->symbol = -1;
+}
+
+/**
+Points the children or the leaf entry of the node at a position back at it
+@param tree is the tree to fix
+@param position is the node that moved
+*/
+static void adoptChildren(adaptiveTree *tree, int position) {
+  adaptiveNode *moved = &tree->nodes[position];
+  if (moved->left >= 0) {
+    tree->nodes[moved->left].parent = position;
+    tree->nodes[moved->right].parent = position;
+  } else if (moved->symbol >= 0) {
+    tree->leaf[moved->symbol] = position;
+  }
+}
+
+/**
+Swaps two subtrees. Each position keeps its parent, so only the two subtree
+roots move.
+@param tree is the tree to change
+@param i is the position of the first subtree
+@param j is the position of the second subtree
+*/
+static void swapNodes(adaptiveTree *tree, int i, int j) {
+  adaptiveNode first = tree->nodes[i];
+  adaptiveNode second = tree->nodes[j];
+  tree->nodes[i] = second;
+  tree->nodes[i].parent = first.parent;
+  tree->nodes[j] = first;
+  tree->nodes[j].parent = second.parent;
+  adoptChildren(tree, i);
+  adoptChildren(tree, j);
+}
+
+/**
+Counts one more occurrence of a symbol and restores the sibling property
+@param tree is the tree to update
+@param symbol is the symbol that was coded
+*/
+void updateAdaptiveTree(adaptiveTree *tree, int symbol) {
+  adaptiveNode *nodes = tree->nodes;
+  int position = tree->leaf[symbol];
+  if (position < 0) {
+    /* The NYT node becomes the parent of a new NYT node and the new leaf */
+    int parent = tree->nyt;
+    int nyt = parent - 2;
+    position = parent - 1;
+    nodes[parent].left = nyt;
+    nodes[parent].right = position;
+    nodes[nyt] = (adaptiveNode){0, parent, -1, -1, -1};
+    nodes[position] = (adaptiveNode){0, parent, -1, -1, symbol};
+    tree->leaf[symbol] = position;
+    tree->nyt = nyt;
+  }
+  while (position >= 0) {
+    /* Weights never decrease with the node number, so the leader of the
+     * block of equal weights is found by scanning up */
+    uint64_t weight = nodes[position].weight;
+    int leader = position;
+    while (leader < tree->root && nodes[leader + 1].weight == weight) {
+      leader++;
+    }
+    if (leader != position && leader != nodes[position].parent) {
+      swapNodes(tree, position, leader);
+      position = leader;
+    }
+    nodes[position].weight++;
+    position = nodes[position].parent;
+  }
+}
+
+/**
+Appends the code of a symbol and updates the tree. A symbol the tree has not
+seen yet is coded as the NYT code followed by LITERAL_BITS bits.
+@param tree is the tree to code with
+@param symbol is the symbol to code
+@param writer is the bit writer to append to
+*/
+void encodeAdaptive(adaptiveTree *tree, int symbol, bitWriter *writer) {
+  int position = tree->leaf[symbol] >= 0 ? tree->leaf[symbol] : tree->nyt;
+  /* The path is found leaf first but written root first */
+  uint8_t path[ADAPTIVE_NODES];
+  int depth = 0;
+  while (position != tree->root) {
+    int parent = tree->nodes[position].parent;
+    path[depth++] = tree->nodes[parent].right == position;
+    position = parent;
+  }
+  while (depth > 0) {
+    int take = depth < 32 ? depth : 32;
+    uint32_t bits = 0;
+    for (int i = 0; i < take; i++) {
+      bits = bits << 1 | path[--depth];
+    }
+    putBits(writer, bits, take);
+  }
+  if (tree->leaf[symbol] < 0) {
+    putBits(writer, (uint32_t)symbol, LITERAL_BITS);
+  }
+  updateAdaptiveTree(tree, symbol);
+}
+
+/**
+Opens a file for a stream, where "-" stands for standard input or output
+@param path is the file to open
+@param mode is the fopen() mode
+@return the open file, or NULL with a message printed to stderr
+*/
+static FILE *openStream(const char *path, const char *mode) {
+  if (strcmp(path, "-") == 0) {
+    return mode[0] == 'r' ? stdin : stdout;
+  }
+  FILE *file = fopen(path, mode);
+  if (file == NULL) {
+    perror(path);
+  }
+  return file;
+}
+
+/**
+Closes a file opened by openStream()
+@param file is the file to close
+@param path is its name, for error messages
+@return 0 on success, -1 if pending output could not be written
+*/
+static int closeStream(FILE *file, const char *path) {
+  int status = file == stdin || file == stdout ? fflush(file) : fclose(file);
+  if (status != 0) {
+    perror(path);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+Writes out the whole bytes in an output buffer and empties it
+@param out is the file to write to
+@param output is the output buffer
+@param writer is the bit writer over output; its pending bits stay in it
+@param outputBytes is increased by the number of bytes written
+@return 0 on success, -1 if the write failed
+*/
+static int writeStreamBytes(FILE *out, uint8_t *output, bitWriter *writer,
+                            uint64_t *outputBytes) {
+  size_t size = (size_t)(writer->ptr - output);
+  if (fwrite(output, 1, size, out) != size) {
+    return -1;
+  }
+  *outputBytes += size;
+  writer->ptr = output;
+  return 0;
+}
+
+/**
+Compresses a stream in one pass with adaptive huffman codes. Whatever each read
+returns is coded and written out at once, so a pipe reader sees the output of
+a live input without waiting for a full buffer.
+@param inPath is the file to compress, or "-" for standard input
+@param outPath is the file to write, or "-" for standard output
+@param result receives the sizes and time taken, may be NULL
+@return 0 on success, -1 on failure with a message printed to stderr
+*/
+int compressStream(const char *inPath, const char *outPath,
+                   codingResult *result) {
+  double start = now();
+  FILE *in = openStream(inPath, "rb");
+  if (in == NULL) {
+    return -1;
+  }
+  FILE *out = openStream(outPath, "wb");
+  if (out == NULL) {
+    closeStream(in, inPath);
+    return -1;
+  }
+  adaptiveTree *tree = malloc(sizeof(adaptiveTree));
+  uint8_t *input = malloc(STREAM_CHUNK);
+  uint8_t *output = malloc(STREAM_CHUNK + STREAM_SLACK);
+  bitWriter writer;
+  uint64_t inputBytes = 0, outputBytes = 0;
+  int status = -1;
+  if (tree == NULL || input == NULL || output == NULL) {
+    perror(inPath);
+    goto done;
+  }
+  initAdaptiveTree(tree);
+  storeMagic(output, MAGIC_STREAM);
+  bitWriterInit(&writer, output + 4);
+  /* read() returns whatever a pipe holds instead of waiting for a full
+   * chunk, so the output keeps up with a live input */
+  ssize_t count;
+  while ((count = read(fileno(in), input, STREAM_CHUNK)) != 0) {
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror(inPath);
+      goto done;
+    }
+    inputBytes += (size_t)count;
+    for (ssize_t i = 0; i < count; i++) {
+      encodeAdaptive(tree, input[i], &writer);
+      if (writer.ptr - output >= STREAM_CHUNK &&
+          writeStreamBytes(out, output, &writer, &outputBytes) < 0) {
+        perror(outPath);
+        goto done;
+      }
+    }
+    /* Hand on every whole byte coded so far; the last partial byte waits in
+     * the writer for the bits that complete it */
+    drainBits(&writer);
+    if (writeStreamBytes(out, output, &writer, &outputBytes) < 0 ||
+        fflush(out) != 0) {
+      perror(outPath);
+      goto done;
+    }
+  }
+  encodeAdaptive(tree, END_OF_STREAM, &writer);
+  finishBits(&writer);
+  if (writeStreamBytes(out, output, &writer, &outputBytes) < 0) {
+    perror(outPath);
+    goto done;
+  }
+  status = 0;
+  countStat(COUNTER_BYTES_IN, inputBytes);
+  countStat(COUNTER_BYTES_OUT, outputBytes);
+
+done:
+  if (closeStream(out, outPath) < 0) {
+    status = -1;
+  }
+  closeStream(in, inPath);
+  free(tree);
+  free(input);
+  free(output);
+  if (result != NULL) {
+    result->inputBytes = inputBytes;
+    result->outputBytes = outputBytes;
+    result->payloadBits = 0;
+    result->optimalBits = 0;
+    result->seconds = now() - start;
+  }
+  return status;
+}
+
+/**
+Bit at a time reader over a file, which also holds the bytes decoded from it
+so that they can be handed on before it waits for more input
+*/
+typedef struct StreamReader {
+  FILE *file;           /**< File being read */
+  uint8_t *buffer;      /**< Up to STREAM_CHUNK bytes of the file */
+  size_t size;          /**< Number of bytes in buffer */
+  size_t position;      /**< Next byte of buffer */
+  unsigned bits;        /**< Current byte */
+  int count;            /**< Bits of the current byte not read yet */
+  uint64_t total;       /**< Bytes read from the file */
+  FILE *out;            /**< File the decoded bytes go to */
+  uint8_t *output;      /**< STREAM_CHUNK bytes of decoded output */
+  size_t pending;       /**< Number of bytes in output not written yet */
+  uint64_t outputBytes; /**< Bytes written to out */
+  int readFailed;       /**< 1 if reading the file failed, errno tells why */
+  int writeFailed;      /**< 1 if writing out failed, errno tells why */
+} streamReader;
+
+/**
+Writes out the decoded bytes a reader holds
+@param reader is the reader
+@return 0 on success, -1 if the write failed
+*/
+static int writeDecoded(streamReader *reader) {
+  if (fwrite(reader->output, 1, reader->pending, reader->out) !=
+          reader->pending ||
+      fflush(reader->out) != 0) {
+    reader->writeFailed = 1;
+    return -1;
+  }
+  reader->outputBytes += reader->pending;
+  reader->pending = 0;
+  return 0;
+}
+
+/**
+Refills the buffer of a reader with whatever the file holds. read() returns
+what a pipe has instead of waiting for a full chunk, and the bytes decoded so
+far are written out first, so the output keeps up with a live input.
+@param reader is the reader, with its buffer used up
+@return the number of bytes read, 0 at the end of the file, -1 on failure
+*/
+static ssize_t fillReader(streamReader *reader) {
+  if (writeDecoded(reader) < 0) {
+    return -1;
+  }
+  ssize_t count;
+  do {
+    count = read(fileno(reader->file), reader->buffer, STREAM_CHUNK);
+  } while (count < 0 && errno == EINTR);
+  if (count < 0) {
+    reader->readFailed = 1;
+    return -1;
+  }
+  reader->size = (size_t)count;
+  reader->position = 0;
+  reader->total += (size_t)count;
+  return count;
+}
+
+/**
+Reads the next bit of a stream
+@param reader is the stream to read
+@return the bit, or -1 at the end of the file or if a read or write failed
+*/
+static inline int readBit(streamReader *reader) {
+  if (reader->count == 0) {
+    if (reader->position == reader->size && fillReader(reader) <= 0) {
+      return -1;
+    }
+    reader->bits = reader->buffer[reader->position++];
+    reader->count = 8;
+  }
+  reader->count--;
+  return (reader->bits >> reader->count) & 1;
+}
+
+/**
+Decodes the next symbol and updates the tree
+@param tree is the tree to decode with
+@param reader is the stream to read
+@return the symbol, or -1 if the stream ends in the middle of a code or a read
+or write failed
+*/
+static int decodeAdaptive(adaptiveTree *tree, streamReader *reader) {
+  int position = tree->root;
+  while (tree->nodes[position].left >= 0) {
+    int bit = readBit(reader);
+    if (bit < 0) {
+      return -1;
+    }
+    position = bit ? tree->nodes[position].right : tree->nodes[position].left;
+  }
+  int symbol = tree->nodes[position].symbol;
+  if (position == tree->nyt) {
+    symbol = 0;
+    for (int i = 0; i < LITERAL_BITS; i++) {
+      int bit = readBit(reader);
+      if (bit < 0) {
+        return -1;
+      }
+      symbol = symbol << 1 | bit;
+    }
+    /* A literal must be new, or the tree would get two leaves for it */
+    if (symbol >= ADAPTIVE_SYMBOLS || tree->leaf[symbol] >= 0) {
+      return -1;
+    }
+  }
+  updateAdaptiveTree(tree, symbol);
+  return symbol;
+}
+
+/**
+Decompresses a stream written by compressStream(). The bytes decoded so far
+are written out before each read that may wait on a live input.
+@param inPath is the compressed stream, or "-" for standard input
+@param outPath is the file to write, or "-" for standard output
+@param result receives the sizes and time taken, may be NULL
+@return 0 on success, -1 on failure with a message printed to stderr
+*/
+int decompressStream(const char *inPath, const char *outPath,
+                     codingResult *result) {
+  double start = now();
+  FILE *in = openStream(inPath, "rb");
+  if (in == NULL) {
+    return -1;
+  }
+  FILE *out = openStream(outPath, "wb");
+  if (out == NULL) {
+    closeStream(in, inPath);
+    return -1;
+  }
+  adaptiveTree *tree = malloc(sizeof(adaptiveTree));
+  streamReader reader = {0};
+  reader.file = in;
+  reader.buffer = malloc(STREAM_CHUNK);
+  reader.out = out;
+  reader.output = malloc(STREAM_CHUNK);
+  int status = -1;
+  if (tree == NULL || reader.buffer == NULL || reader.output == NULL) {
+    perror(inPath);
+    goto done;
+  }
+  initAdaptiveTree(tree);
+  /* The magic goes through the reader too, as a stdio buffer would hold on
+   * to bytes that read() then skips */
+  uint8_t magic[4];
+  int magicSize = 0;
+  while (magicSize < 4 &&
+         (reader.position < reader.size || fillReader(&reader) > 0)) {
+    magic[magicSize++] = reader.buffer[reader.position++];
+  }
+  if (magicSize < 4 || !checkMagic(magic, MAGIC_STREAM)) {
+    if (reader.readFailed) {
+      perror(inPath);
+    } else {
+      fprintf(stderr, "%s: not an adaptive stream\n", inPath);
+    }
+    goto done;
+  }
+  for (;;) {
+    int symbol = decodeAdaptive(tree, &reader);
+    if (symbol < 0 || (reader.pending == STREAM_CHUNK &&
+                       writeDecoded(&reader) < 0)) {
+      if (reader.readFailed || reader.writeFailed) {
+        perror(reader.readFailed ? inPath : outPath);
+      } else {
+        fprintf(stderr, "%s: corrupt or truncated stream\n", inPath);
+      }
+      goto done;
+    }
+    if (symbol == END_OF_STREAM) {
+      break;
+    }
+    reader.output[reader.pending++] = (uint8_t)symbol;
+  }
+  if (writeDecoded(&reader) < 0) {
+    perror(outPath);
+    goto done;
+  }
+  status = 0;
+  countStat(COUNTER_BYTES_IN, reader.total);
+  countStat(COUNTER_BYTES_OUT, reader.outputBytes);
+
+done:
+  if (closeStream(out, outPath) < 0) {
+    status = -1;
+  }
+  closeStream(in, inPath);
+  free(tree);
+  free(reader.buffer);
+  free(reader.output);
+  if (result != NULL) {
+    result->inputBytes = reader.total;
+    result->outputBytes = reader.outputBytes;
+    result->payloadBits = 0;
+    result->optimalBits = 0;
+    result->seconds = now() - start;
+  }
+  return status;
+}
@@ -0,0 +1,96 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file contains the interface for adaptive (FGK) huffman coding.
+        Encoder and decoder start from the same empty tree and update it
+        after every symbol, so no frequency table is sent and the input is
+        read once, in fixed size chunks. That makes it suitable for pipes
+        and other streams of unknown length, in constant memory.
+
+*/
+
+#ifndef _ADAPTIVE_H_
+#define _ADAPTIVE_H_
+
+#include "bitio.h"
+#include "encoder.h"
+#include <stdint.h>
+
+/** Byte values plus the end of stream marker */
+#define ADAPTIVE_SYMBOLS 257
+/** Symbol that ends a stream */
+#define END_OF_STREAM 256
+/** Bits that spell out a symbol the tree has not seen yet */
+#define LITERAL_BITS 9
+/** Most nodes a tree can have: every symbol and the NYT node as leaves */
+#define ADAPTIVE_NODES (2 * ADAPTIVE_SYMBOLS + 1)
+
+/**
+One node of an adaptive tree. A node's position in the tree's array is its
+node number, which orders the nodes by weight.
+*/
+typedef struct AdaptiveNode {
+  uint64_t weight; /**< Number of times the symbols below were seen */
+  int parent;      /**< Parent position, -1 for the root */
+  int left;        /**< Left child position, -1 for a leaf */
+  int right;       /**< Right child position, -1 for a leaf */
+  int symbol;      /**< Symbol of a leaf, -1 for internal and NYT nodes */
+} adaptiveNode;
+
+/**
+Huffman tree that keeps the sibling property as symbols are counted
+*/
+typedef struct AdaptiveTree {
+  adaptiveNode nodes[ADAPTIVE_NODES]; /**< Nodes by increasing number */
+  int leaf[ADAPTIVE_SYMBOLS]; /**< Position of each symbol, -1 if unseen */
+  int nyt;                    /**< Position of the not yet transmitted node */
+  int root;                   /**< Position of the root */
+} adaptiveTree;
+
+/**
+Resets a tree to the NYT node alone
+@param tree is the tree to reset
+*/
+void initAdaptiveTree(adaptiveTree *tree);
+
+/**
+Counts one more occurrence of a symbol and restores the sibling property
+@param tree is the tree to update
+@param symbol is the symbol that was coded
+*/
+void updateAdaptiveTree(adaptiveTree *tree, int symbol);
+
+/**
+Appends the code of a symbol and updates the tree. A symbol the tree has not
+seen yet is coded as the NYT code followed by LITERAL_BITS bits.
+@param tree is the tree to code with
+@param symbol is the symbol to code
+@param writer is the bit writer to append to
+*/
+void encodeAdaptive(adaptiveTree *tree, int symbol, bitWriter *writer);
+
+/**
+Compresses a stream in one pass with adaptive huffman codes
+@param inPath is the file to compress, or "-" for standard input
+@param outPath is the file to write, or "-" for standard output
+@param result receives the sizes and time taken, may be NULL
+@return 0 on success, -1 on failure with a message printed to stderr
+*/
+int compressStream(const char *inPath, const char *outPath,
+                   codingResult *result);
+
+/**
+Decompresses a stream written by compressStream(). The bytes decoded so far
+are written out before each read that may wait on a live input.
+@param inPath is the compressed stream, or "-" for standard input
+@param outPath is the file to write, or "-" for standard output
+@param result receives the sizes and time taken, may be NULL
+@return 0 on success, -1 on failure with a message printed to stderr
+*/
+int decompressStream(const char *inPath, const char *outPath,
+                     codingResult *result);
+
+#endif
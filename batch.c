@@ -0,0 +1,707 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file implements batch compression and decompression. Every
+        file is one task on a shared pool of workers and is coded on the
+        worker that picks it up, so small files keep every processor busy
+        where splitting each of them into blocks would not. Files written
+        next to their originals finish in any order. Archive members are
+        compressed in memory with the block stream codec a batch at a time
+        and written in the order they were given.
+
+ */
+#include "batch.h"
+#include "codec.h"
+#include "format.h"
+#include "input.h"
+#include "stats.h"
+#include "threadpool.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/** Archive members compressed per worker before the batch is written out */
+#define FILES_PER_THREAD 4
+/** Original bytes decoded at a time from an archive member */
+#define MEMBER_CHUNK (1 << 20)
+
+/**
+One file of work for a worker thread
+*/
+typedef struct FileJob {
+  const char *path;              /**< File to code, or member to extract */
+  const char *storedPath;        /**< Path to store an archive member under */
+  char *outPath;                 /**< malloc'd file to write, or NULL to
+                                      compress into data for an archive */
+  const encoderOptions *encoder; /**< Encoder settings when compressing */
+  const decoderOptions *decoder; /**< Decoder settings when decompressing */
+  const uint8_t *member;         /**< Block stream of an archive member */
+  size_t memberSize;             /**< Number of bytes in member */
+  uint8_t *data;                 /**< malloc'd block stream for an archive */
+  size_t size;                   /**< Number of bytes in data */
+  codingResult result;           /**< Sizes and time taken */
+  int status;                    /**< 0 on success, -1 on failure */
+} fileJob;
+
+/**
+Reads a list of paths, one per line. Empty lines are skipped.
+@param path is the list, or "-" for standard input
+@param paths receives a malloc'd array of malloc'd paths
+@param count receives the number of paths
+@return 0 on success, -1 on failure with a message printed to stderr
+*/
+int readManifest(const char *path, char ***paths, int *count) {
+  FILE *in = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+  if (in == NULL) {
+    perror(path);
+    return -1;
+  }
+  char **list = NULL;
+  int size = 0, capacity = 0;
+  char *line = NULL;
+  size_t lineCapacity = 0;
+  ssize_t length;
+  while ((length = getline(&line, &lineCapacity, in)) != -1) {
+    while (length > 0 &&
+           (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+      line[--length] = '\0';
+    }
+    if (length == 0) {
+      continue;
+    }
+    if (size == capacity) {
+      capacity = capacity > 0 ? capacity * 2 : 64;
+      list = realloc(list, sizeof(char *) * capacity);
+    }
+    list[size++] = strdup(line);
+  }
+  free(line);
+  int failed = ferror(in);
+  if (in != stdin) {
+    fclose(in);
+  }
+  if (failed) {
+    perror(path);
+    for (int i = 0; i < size; i++) {
+      free(list[i]);
+    }
+    free(list);
+    return -1;
+  }
+  *paths = list;
+  *count = size;
+  return 0;
+}
+
+/**
+Path an archive member is stored under: the file's path without leading
+slashes, repeated slashes and "." components, so it extracts below the
+current directory and every way of naming a file gives the same member
+@param path is the file
+@return the malloc'd member path
+*/
+static char *memberPath(const char *path) {
+  char *member = malloc(strlen(path) + 1);
+  size_t size = 0;
+  while (*path != '\0') {
+    size_t length = strcspn(path, "/");
+    if (length > 1 || (length == 1 && path[0] != '.')) {
+      if (size > 0) {
+        member[size++] = '/';
+      }
+      memcpy(member + size, path, length);
+      size += length;
+    }
+    path += length;
+    while (*path == '/') {
+      path++;
+    }
+  }
+  member[size] = '\0';
+  return member;
+}
+
+/**
+Checks that a member path stays below the current directory and is the only
+way to name its file, as memberPath() leaves it
+@param path is the member path
+@return 1 if it is relative and has no empty, "." or ".." component, 0
+otherwise
+*/
+static int safeMemberPath(const char *path) {
+  for (;;) {
+    size_t length = strcspn(path, "/");
+    if (length == 0 || (path[0] == '.' && (length == 1 ||
+                                           (length == 2 && path[1] == '.')))) {
+      return 0;
+    }
+    if (path[length] == '\0') {
+      return 1;
+    }
+    path += length + 1;
+  }
+}
+
+/**
+Compares two paths for qsort()
+@param a points to the first path
+@param b points to the second path
+@return negative, zero or positive as strcmp()
+*/
+static int comparePaths(const void *a, const void *b) {
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/**
+Finds a path that appears more than once in a list
+@param paths is the list
+@param count is the number of paths
+@return one of the repeated paths, or NULL if every path is different
+*/
+static const char *findDuplicate(char *const *paths, int count) {
+  char **sorted = malloc(sizeof(char *) * (count > 0 ? count : 1));
+  memcpy(sorted, paths, sizeof(char *) * count);
+  qsort(sorted, count, sizeof(char *), comparePaths);
+  const char *duplicate = NULL;
+  for (int i = 1; i < count && duplicate == NULL; i++) {
+    if (strcmp(sorted[i - 1], sorted[i]) == 0) {
+      duplicate = sorted[i];
+    }
+  }
+  free(sorted);
+  return duplicate;
+}
+
+/**
+Works out the member paths of the files of an archive, and checks that each
+can be stored and extracted again to a file of its own
+@param paths is the files
+@param count is the number of files
+@return a malloc'd array of malloc'd member paths, or NULL with messages
+printed to stderr
+*/
+static char **memberPaths(char *const *paths, int count) {
+  char **members = malloc(sizeof(char *) * (count > 0 ? count : 1));
+  int failed = 0;
+  for (int i = 0; i < count; i++) {
+    members[i] = memberPath(paths[i]);
+    if (strlen(members[i]) > MAX_MEMBER_PATH) {
+      fprintf(stderr, "%s: path is too long for an archive\n", paths[i]);
+      failed = 1;
+    } else if (!safeMemberPath(members[i])) {
+      fprintf(stderr, "%s: path would extract outside the current directory\n",
+              paths[i]);
+      failed = 1;
+    }
+  }
+  const char *duplicate = failed ? NULL : findDuplicate(members, count);
+  if (duplicate != NULL) {
+    fprintf(stderr, "%s: more than one file is stored under this path\n",
+            duplicate);
+  }
+  if (failed || duplicate != NULL) {
+    for (int i = 0; i < count; i++) {
+      free(members[i]);
+    }
+    free(members);
+    return NULL;
+  }
+  return members;
+}
+
+/**
+Creates the directories a member path goes through
+@param path is the member path
+@return 0 on success, -1 on failure
+*/
+static int makeParents(const char *path) {
+  char *parent = strdup(path);
+  int status = 0;
+  for (char *slash = strchr(parent, '/'); slash != NULL && status == 0;
+       slash = strchr(slash + 1, '/')) {
+    *slash = '\0';
+    if (mkdir(parent, 0777) < 0 && errno != EEXIST) {
+      status = -1;
+    }
+    *slash = '/';
+  }
+  free(parent);
+  return status;
+}
+
+/**
+Joins a path and a suffix
+@param path is the path
+@param suffix is appended to it
+@param strip is a suffix to remove instead if path ends with it, or NULL
+@return the new malloc'd path
+*/
+static char *changeSuffix(const char *path, const char *suffix,
+                          const char *strip) {
+  size_t length = strlen(path);
+  if (strip != NULL) {
+    size_t stripLength = strlen(strip);
+    if (length > stripLength &&
+        strcmp(path + length - stripLength, strip) == 0) {
+      return strndup(path, length - stripLength);
+    }
+  }
+  char *out = malloc(length + strlen(suffix) + 1);
+  strcpy(out, path);
+  strcpy(out + length, suffix);
+  return out;
+}
+
+/**
+Compresses a whole file into a block stream in memory
+@param job is the job, whose data and size receive the stream
+@return 0 on success, -1 on failure with a message printed to stderr
+*/
+static int compressMember(fileJob *job) {
+  inputSource input;
+  if (openInput(job->path, &input) < 0) {
+    return -1;
+  }
+  compressor *c = createCompressor(job->encoder);
+  size_t bound = c != NULL ? compressBound(c, input.size) : 0;
+  job->data = c != NULL ? malloc(bound) : NULL;
+  if (job->data == NULL) {
+    perror(job->path);
+    freeCompressor(c);
+    closeInput(&input);
+    return -1;
+  }
+  int64_t size = compressUpdate(c, input.data, input.size, job->data, bound);
+  int64_t end = size < 0 ? -1
+                         : compressEnd(c, job->data + size, bound - size);
+  freeCompressor(c);
+  job->result.inputBytes = input.size;
+  closeInput(&input);
+  if (end < 0) {
+    fprintf(stderr, "%s: codes cannot be limited to %d bits\n", job->path,
+            job->encoder->maxCodeLength);
+    return -1;
+  }
+  job->size = (size_t)(size + end);
+  job->result.outputBytes = job->size;
+  return 0;
+}
+
+/**
+Decodes an archive member into the file named by its path
+@param job is the job
+@return 0 on success, -1 on failure with a message printed to stderr
+*/
+static int extractMember(fileJob *job) {
+  FILE *out = makeParents(job->path) == 0 ? fopen(job->path, "wb") : NULL;
+  if (out == NULL) {
+    perror(job->path);
+    return -1;
+  }
+  decompressor *d = createDecompressor();
+  uint8_t *buffer = malloc(MEMBER_CHUNK);
+  const uint8_t *in = job->member;
+  size_t left = job->memberSize;
+  uint64_t outputBytes = 0;
+  int status = -1;
+  if (d == NULL || buffer == NULL) {
+    perror(job->path);
+  }
+  while (d != NULL && buffer != NULL) {
+    size_t used;
+    int64_t size = decompressUpdate(d, in, left, &used, buffer, MEMBER_CHUNK);
+    if (size < 0) {
+      fprintf(stderr, "%s: corrupt archive member\n", job->path);
+      break;
+    }
+    in += used;
+    left -= used;
+    uint64_t start = startPhase();
+    size_t written = fwrite(buffer, 1, (size_t)size, out);
+    endPhase(PHASE_WRITE, start);
+    if (written != (size_t)size) {
+      perror(job->path);
+      break;
+    }
+    outputBytes += (uint64_t)size;
+    /* Nothing moved: the stream ended or the member ran out */
+    if (size == 0 && used == 0) {
+      if (decompressEnd(d) < 0 || left != 0) {
+        fprintf(stderr, "%s: corrupt archive member\n", job->path);
+      } else {
+        status = 0;
+      }
+      break;
+    }
+  }
+  free(buffer);
+  freeDecompressor(d);
+  if (fclose(out) != 0 && status == 0) {
+    perror(job->path);
+    status = -1;
+  }
+  job->result.inputBytes = job->memberSize;
+  job->result.outputBytes = outputBytes;
+  return status;
+}
+
+/**
+Worker task: compresses the file of a job
+@param argument is the fileJob
+*/
+static void runCompressJob(void *argument) {
+  fileJob *job = argument;
+  if (job->outPath != NULL) {
+    job->status =
+        compressFile(job->path, job->outPath, job->encoder, &job->result);
+  } else {
+    double start = now();
+    job->status = compressMember(job);
+    job->result.seconds = now() - start;
+  }
+}
+
+/**
+Worker task: decompresses the file or archive member of a job
+@param argument is the fileJob
+*/
+static void runDecompressJob(void *argument) {
+  fileJob *job = argument;
+  if (job->member != NULL) {
+    double start = now();
+    job->status = extractMember(job);
+    job->result.seconds = now() - start;
+  } else {
+    job->status =
+        decompressFile(job->path, job->outPath, job->decoder, &job->result);
+  }
+}
+
+/**
+Runs a task for every job of a batch, on the pool if there is one
+@param pool is the thread pool, or NULL to run the tasks on this thread
+@param task is the task to run
+@param jobs is the batch
+@param count is the number of jobs in the batch
+*/
+static void runBatch(threadPool *pool, void (*task)(void *), fileJob *jobs,
+                     int count) {
+  for (int i = 0; i < count; i++) {
+    if (pool != NULL) {
+      submitTask(pool, task, &jobs[i]);
+    } else {
+      task(&jobs[i]);
+    }
+  }
+  if (pool != NULL) {
+    waitForTasks(pool);
+  }
+}
+
+/**
+Adds the outcome of a job to the totals of a batch
+@param result is the totals
+@param job is the finished job
+*/
+static void addResult(batchResult *result, const fileJob *job) {
+  if (job->status < 0) {
+    result->failed++;
+    return;
+  }
+  result->files++;
+  result->total.inputBytes += job->result.inputBytes;
+  result->total.outputBytes += job->result.outputBytes;
+  result->total.payloadBits += job->result.payloadBits;
+  result->total.optimalBits += job->result.optimalBits;
+}
+
+/**
+Appends a compressed member to an archive
+@param out is the archive
+@param job is the job holding the member
+@return the number of bytes written, or 0 on failure
+*/
+static size_t writeMember(FILE *out, const fileJob *job) {
+  const char *path = job->storedPath;
+  size_t pathSize = strlen(path);
+  uint8_t field[8];
+  store16(field, (uint16_t)pathSize);
+  if (fwrite(field, 1, 2, out) != 2 ||
+      fwrite(path, 1, pathSize, out) != pathSize) {
+    return 0;
+  }
+  store64(field, job->size);
+  if (fwrite(field, 1, 8, out) != 8 ||
+      fwrite(job->data, 1, job->size, out) != job->size) {
+    return 0;
+  }
+  return 2 + pathSize + 8 + job->size;
+}
+
+/**
+Compresses many files on a pool of workers, one file at a time per worker.
+Each file is written next to itself with BATCH_SUFFIX added, or into an
+archive.
+@param paths is the files to compress
+@param count is the number of files
+@param options are the encoder settings; options->threads is the number of
+workers, and each file is coded on one of them
+@param archive is the archive to write, or NULL to write files
+@param result receives the totals and time taken
+@return 0 if every file was compressed, -1 otherwise with messages printed to
+stderr
+*/
+int compressBatch(char *const *paths, int count,
+                  const encoderOptions *options, const char *archive,
+                  batchResult *result) {
+  double start = now();
+  memset(result, 0, sizeof(*result));
+  const char *error = checkEncoderOptions(options);
+  if (error != NULL) {
+    fprintf(stderr, "%s\n", error);
+    return -1;
+  }
+  /* Every member must be extractable, to a file of its own, before any of
+   * them is written */
+  char **members = NULL;
+  if (archive != NULL && (members = memberPaths(paths, count)) == NULL) {
+    return -1;
+  }
+  FILE *out = NULL;
+  if (archive != NULL) {
+    uint8_t header[ARCHIVE_HEADER_SIZE];
+    storeMagic(header, MAGIC_ARCHIVE);
+    out = fopen(archive, "wb");
+    uint64_t writeStart = startPhase();
+    if (out == NULL ||
+        fwrite(header, 1, ARCHIVE_HEADER_SIZE, out) != ARCHIVE_HEADER_SIZE) {
+      perror(archive);
+      if (out != NULL) {
+        fclose(out);
+      }
+      for (int i = 0; i < count; i++) {
+        free(members[i]);
+      }
+      free(members);
+      return -1;
+    }
+    endPhase(PHASE_WRITE, writeStart);
+    countStat(COUNTER_BYTES_OUT, ARCHIVE_HEADER_SIZE);
+    result->total.outputBytes = ARCHIVE_HEADER_SIZE;
+  }
+  /* Parallelism comes from coding many files at once, not from splitting
+   * each one */
+  encoderOptions fileOptions = *options;
+  fileOptions.threads = 1;
+  int threads = options->threads > 0 ? options->threads : 1;
+  threadPool *pool = threads > 1 ? createThreadPool(threads) : NULL;
+  /* Files written next to their originals may finish in any order, but
+   * archive members wait in memory until the batch is written */
+  int batchSize = archive != NULL ? threads * FILES_PER_THREAD : count;
+  fileJob *jobs = calloc(batchSize > 0 ? batchSize : 1, sizeof(fileJob));
+  int writeFailed = 0;
+
+  for (int first = 0; first < count && !writeFailed; first += batchSize) {
+    int size = count - first < batchSize ? count - first : batchSize;
+    for (int i = 0; i < size; i++) {
+      memset(&jobs[i], 0, sizeof(fileJob));
+      jobs[i].path = paths[first + i];
+      jobs[i].encoder = &fileOptions;
+      if (archive == NULL) {
+        jobs[i].outPath = changeSuffix(jobs[i].path, BATCH_SUFFIX, NULL);
+      } else {
+        jobs[i].storedPath = members[first + i];
+      }
+    }
+    runBatch(pool, runCompressJob, jobs, size);
+    for (int i = 0; i < size; i++) {
+      addResult(result, &jobs[i]);
+      if (out != NULL && jobs[i].status == 0 && !writeFailed) {
+        uint64_t writeStart = startPhase();
+        size_t written = writeMember(out, &jobs[i]);
+        endPhase(PHASE_WRITE, writeStart);
+        if (written == 0) {
+          perror(archive);
+          writeFailed = 1;
+        } else {
+          /* The member's own size is already counted, by the codec too */
+          result->total.outputBytes += written - jobs[i].size;
+          countStat(COUNTER_BYTES_OUT, written - jobs[i].size);
+        }
+      }
+      free(jobs[i].outPath);
+      free(jobs[i].data);
+    }
+  }
+  if (pool != NULL) {
+    destroyThreadPool(pool);
+  }
+  free(jobs);
+  for (int i = 0; archive != NULL && i < count; i++) {
+    free(members[i]);
+  }
+  free(members);
+  if (out != NULL && !writeFailed) {
+    uint8_t footer[ARCHIVE_FOOTER_SIZE] = {0};
+    uint64_t writeStart = startPhase();
+    if (fwrite(footer, 1, ARCHIVE_FOOTER_SIZE, out) != ARCHIVE_FOOTER_SIZE) {
+      perror(archive);
+      writeFailed = 1;
+    }
+    endPhase(PHASE_WRITE, writeStart);
+    countStat(COUNTER_BYTES_OUT, ARCHIVE_FOOTER_SIZE);
+    result->total.outputBytes += ARCHIVE_FOOTER_SIZE;
+  }
+  if (out != NULL && fclose(out) != 0 && !writeFailed) {
+    perror(archive);
+    writeFailed = 1;
+  }
+  result->total.seconds = now() - start;
+  return writeFailed || result->failed > 0 ? -1 : 0;
+}
+
+/**
+Adds a job to a growing list
+@param jobs is the list, reallocated as needed
+@param count is the number of jobs in the list
+@param capacity is the room in the list
+@return the new job, zeroed
+*/
+static fileJob *addJob(fileJob **jobs, int *count, int *capacity) {
+  if (*count == *capacity) {
+    *capacity = *capacity > 0 ? *capacity * 2 : 64;
+    *jobs = realloc(*jobs, sizeof(fileJob) * *capacity);
+  }
+  fileJob *job = &(*jobs)[(*count)++];
+  memset(job, 0, sizeof(fileJob));
+  return job;
+}
+
+/**
+Adds a job for every member of an archive
+@param path is the archive, for messages
+@param input is the contents of the archive
+@param jobs is the list, reallocated as needed
+@param count is the number of jobs in the list
+@param capacity is the room in the list
+@return the number of members that cannot be extracted
+*/
+static int addMembers(const char *path, const inputSource *input,
+                      fileJob **jobs, int *count, int *capacity) {
+  size_t offset = ARCHIVE_HEADER_SIZE;
+  int failed = 0;
+  for (;;) {
+    const uint8_t *field = input->data + offset;
+    size_t left = input->size - offset;
+    /* Only the footer may have a zero path size, and nothing follows it */
+    if (left == ARCHIVE_FOOTER_SIZE && load16(field) == 0) {
+      return failed;
+    }
+    size_t pathSize = left >= 2 ? load16(field) : 0;
+    if (pathSize == 0 || left < 2 + pathSize + 8 ||
+        load64(field + 2 + pathSize) > left - (2 + pathSize + 8)) {
+      fprintf(stderr, "%s: corrupt archive\n", path);
+      return failed + 1;
+    }
+    size_t memberSize = (size_t)load64(field + 2 + pathSize);
+    char *memberPath = strndup((const char *)field + 2, pathSize);
+    offset += 2 + pathSize + 8 + memberSize;
+    if (strlen(memberPath) != pathSize || !safeMemberPath(memberPath)) {
+      fprintf(stderr, "%s: refusing to extract %s\n", path, memberPath);
+      free(memberPath);
+      failed++;
+      continue;
+    }
+    fileJob *job = addJob(jobs, count, capacity);
+    job->path = memberPath;
+    job->outPath = memberPath;
+    job->member = field + 2 + pathSize + 8;
+    job->memberSize = memberSize;
+  }
+  return failed;
+}
+
+/**
+Decompresses many files on a pool of workers. A file ending in BATCH_SUFFIX
+is written without it and any other file with ".out" added. An archive has
+every member written to the path it was stored under, relative to the
+current directory.
+@param paths is the compressed files and archives
+@param count is the number of files
+@param options are the decoder settings; options->threads is the number of
+workers
+@param result receives the totals and time taken
+@return 0 if every file was decompressed, -1 otherwise with messages printed
+to stderr
+*/
+int decompressBatch(char *const *paths, int count,
+                    const decoderOptions *options, batchResult *result) {
+  double start = now();
+  memset(result, 0, sizeof(*result));
+  decoderOptions fileOptions = *options;
+  fileOptions.threads = 1;
+  /* Archives stay mapped until their members are extracted */
+  inputSource *archives = malloc(sizeof(inputSource) * (count > 0 ? count : 1));
+  int archiveCount = 0;
+  fileJob *jobs = NULL;
+  int jobCount = 0, capacity = 0;
+
+  for (int i = 0; i < count; i++) {
+    inputSource *input = &archives[archiveCount];
+    if (openInput(paths[i], input) < 0) {
+      result->failed++;
+      continue;
+    }
+    if (input->size >= ARCHIVE_HEADER_SIZE &&
+        checkMagic(input->data, MAGIC_ARCHIVE)) {
+      result->failed += addMembers(paths[i], input, &jobs, &jobCount,
+                                   &capacity);
+      archiveCount++;
+      continue;
+    }
+    closeInput(input);
+    fileJob *job = addJob(&jobs, &jobCount, &capacity);
+    job->path = paths[i];
+    job->outPath = changeSuffix(paths[i], ".out", BATCH_SUFFIX);
+    job->decoder = &fileOptions;
+  }
+  /* Two jobs writing one file would race, so then nothing is written */
+  char **outPaths = malloc(sizeof(char *) * (jobCount > 0 ? jobCount : 1));
+  for (int i = 0; i < jobCount; i++) {
+    outPaths[i] = jobs[i].outPath;
+  }
+  const char *duplicate = findDuplicate(outPaths, jobCount);
+  free(outPaths);
+  int runCount = jobCount;
+  if (duplicate != NULL) {
+    fprintf(stderr, "%s: refusing to write this path more than once\n",
+            duplicate);
+    for (int i = 0; i < jobCount; i++) {
+      jobs[i].status = -1;
+    }
+    runCount = 0;
+  }
+  int threads = options->threads > 0 ? options->threads : 1;
+  threadPool *pool =
+      threads > 1 && runCount > 1 ? createThreadPool(threads) : NULL;
+  runBatch(pool, runDecompressJob, jobs, runCount);
+  if (pool != NULL) {
+    destroyThreadPool(pool);
+  }
+  for (int i = 0; i < jobCount; i++) {
+    addResult(result, &jobs[i]);
+    free(jobs[i].outPath);
+  }
+  for (int i = 0; i < archiveCount; i++) {
+    closeInput(&archives[i]);
+  }
+  free(jobs);
+  free(archives);
+  result->total.seconds = now() - start;
+  return result->failed > 0 ? -1 : 0;
+}
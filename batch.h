@@ -0,0 +1,79 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file contains the interface for compressing and decompressing
+        many files in one run. Files are spread over a pool of workers, one
+        file per task, so a batch of small files pays for one process and
+        one pool instead of one of each per file. Outputs go next to the
+        inputs or into a single archive.
+
+*/
+
+#ifndef _BATCH_H_
+#define _BATCH_H_
+
+#include "decoder.h"
+#include "encoder.h"
+#include <stdint.h>
+
+/** Suffix of a compressed file written next to its original */
+#define BATCH_SUFFIX ".huf"
+
+/**
+Totals of a batch
+*/
+typedef struct BatchResult {
+  codingResult total; /**< Summed sizes, and the wall clock time of the run */
+  int files;          /**< Files coded */
+  int failed;         /**< Files that could not be coded */
+} batchResult;
+
+/**
+Reads a list of paths, one per line. Empty lines are skipped.
+@param path is the list, or "-" for standard input
+@param paths receives a malloc'd array of malloc'd paths
+@param count receives the number of paths
+@return 0 on success, -1 on failure with a message printed to stderr
+*/
+int readManifest(const char *path, char ***paths, int *count);
+
+/**
+Compresses many files on a pool of workers, one file at a time per worker.
+Each file is written next to itself with BATCH_SUFFIX added, or into an
+archive. Members are stored under their paths without leading slashes, empty
+and "." components; no archive is written if one of them has a ".."
+component or two files are stored under the same path.
+@param paths is the files to compress
+@param count is the number of files
+@param options are the encoder settings; options->threads is the number of
+workers, and each file is coded on one of them
+@param archive is the archive to write, or NULL to write files
+@param result receives the totals and time taken
+@return 0 if every file was compressed, -1 otherwise with messages printed to
+stderr
+*/
+int compressBatch(char *const *paths, int count,
+                  const encoderOptions *options, const char *archive,
+                  batchResult *result);
+
+/**
+Decompresses many files on a pool of workers. A file ending in BATCH_SUFFIX
+is written without it and any other file with ".out" added. An archive has
+every member written to the path it was stored under, relative to the
+current directory. Nothing is written if two files or members would be
+written to the same path.
+@param paths is the compressed files and archives
+@param count is the number of files
+@param options are the decoder settings; options->threads is the number of
+workers
+@param result receives the totals and time taken
+@return 0 if every file was decompressed, -1 otherwise with messages printed
+to stderr
+*/
+int decompressBatch(char *const *paths, int count,
+                    const decoderOptions *options, batchResult *result);
+
+#endif
@@ -0,0 +1,401 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        Benchmark of every coding phase over a corpus. For each input it
+        times counting the histogram, building the tree with the heap,
+        computing code lengths in place, assigning canonical codes,
+        building the single and multi symbol decode tables, encoding and
+        decoding with either table, each as the best of several runs. It
+        reports MB/s, ns and, on x86, time stamp counter cycles per input
+        symbol for every phase, and the payload bits against the entropy
+        bound and against the sizes in readme.md. Synthetic inputs with known
+        statistics are added to the files given.
+
+        Usage: bench/corpusbench [-c] [-r rounds] [files...]
+          -c        print input,metric,value lines that can be diffed
+                    between commits instead of a table
+          -r        number of runs to take the best of (default 5)
+ */
+#include "decoder.h"
+#include "encoder.h"
+#include "heap.h"
+#include "histogram.h"
+#include "huffman.h"
+#include "input.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/** Number of bytes in each synthetic input */
+#define SYNTHETIC_SIZE (1 << 20)
+/** Shortest time one measurement runs for, in seconds */
+#define MIN_SAMPLE_TIME 0.002
+
+/**
+Payload sizes from the table in readme.md
+*/
+static const struct {
+  const char *file; /**< Name of the example file */
+  uint64_t bits;    /**< Compressed size in bits */
+} references[] = {
+    {"345-0.txt", 4015729},
+    {"1080-0.txt", 185437},
+    {"pg2265.txt", 868320},
+};
+
+/**
+One input and everything derived from it
+*/
+typedef struct Subject {
+  const uint8_t *data;                 /**< Contents of the input */
+  size_t size;                         /**< Number of bytes in data */
+  uint64_t frequencies[ALPHABET_SIZE]; /**< Histogram of data */
+  heap tree;                           /**< Tree built with the heap */
+  codeTable codes;                     /**< Canonical codes from the lengths */
+  decodeTable decoder;                 /**< Decode table for codes */
+  multiDecodeTable multi;              /**< Multi symbol table for codes */
+  uint8_t *encoded;                    /**< Payload coded with codes */
+  size_t encodedSize;                  /**< Number of bytes in encoded */
+  uint8_t *decoded;                    /**< Payload decoded again */
+  uint8_t *multiDecoded;               /**< Payload decoded with multi */
+  uint64_t sink; /**< Keeps results from being optimized out */
+} subject;
+
+/**
+One phase of coding
+*/
+typedef struct Phase {
+  const char *name;           /**< Name in reports */
+  void (*run)(subject *work); /**< Runs the phase once */
+} phase;
+
+/**
+Counts the histogram
+@param work is the input
+*/
+static void runHistogram(subject *work) {
+  memset(work->frequencies, 0, sizeof(work->frequencies));
+  countBytes(work->data, work->size, work->frequencies);
+}
+
+/**
+Builds the huffman tree with the heap
+@param work is the input
+*/
+static void runTree(subject *work) {
+  buildHuffmanTree(work->frequencies, ALPHABET_SIZE, &work->tree);
+  work->sink += work->tree.nodeCount;
+}
+
+/**
+Computes the code lengths in place, as the encoder does
+@param work is the input
+*/
+static void runLengths(subject *work) {
+  work->sink += computeCodeLengths(work->frequencies, ALPHABET_SIZE,
+                                   &work->codes);
+}
+
+/**
+Assigns canonical codes to the lengths
+@param work is the input
+*/
+static void runCodes(subject *work) {
+  work->sink += assignCanonicalCodes(&work->codes);
+}
+
+/**
+Builds the decode table
+@param work is the input
+*/
+static void runDecodeTable(subject *work) {
+  buildDecodeTable(&work->codes, &work->decoder);
+  work->sink += work->decoder.maxLength;
+}
+
+/**
+Builds the multi symbol decode table
+@param work is the input
+*/
+static void runMultiTable(subject *work) {
+  buildMultiDecodeTable(&work->codes, &work->multi);
+  work->sink += work->multi.entries[0].count;
+}
+
+/**
+Encodes the input
+@param work is the input
+*/
+static void runEncode(subject *work) {
+  bitWriter writer;
+  bitWriterInit(&writer, work->encoded);
+  encodeSymbols(&work->codes, work->data, work->size, &writer);
+  work->encodedSize = finishBits(&writer);
+}
+
+/**
+Decodes the payload
+@param work is the input
+*/
+static void runDecode(subject *work) {
+  decodeSymbols(&work->decoder, work->encoded, work->encodedSize,
+                work->decoded, work->size);
+  work->sink += work->decoded[0];
+}
+
+/**
+Decodes the payload with the multi symbol table
+@param work is the input
+*/
+static void runDecodeMulti(subject *work) {
+  decodeMultiSymbols(&work->multi, work->encoded, work->encodedSize,
+                     work->multiDecoded, work->size);
+  work->sink += work->multiDecoded[0];
+}
+
+/** Phases in the order they run */
+static const phase phases[] = {
+    {"histogram", runHistogram},
+    {"tree", runTree},
+    {"lengths", runLengths},
+    {"codes", runCodes},
+    {"decode_table", runDecodeTable},
+    {"multi_table", runMultiTable},
+    {"encode", runEncode},
+    {"decode", runDecode},
+    {"decode_multi", runDecodeMulti},
+};
+
+/**
+Times a phase as the best of several runs. Each run repeats the phase until it
+takes at least MIN_SAMPLE_TIME, so phases on small inputs are measurable.
+@param step is the phase
+@param work is the input
+@param rounds is the number of runs
+@return the best time of one pass of the phase, in seconds
+*/
+static double timePhase(const phase *step, subject *work, int rounds) {
+  long repeats = 1;
+  double start = now();
+  step->run(work);
+  double elapsed = now() - start;
+  if (elapsed < MIN_SAMPLE_TIME) {
+    repeats = (long)(MIN_SAMPLE_TIME / (elapsed > 1e-8 ? elapsed : 1e-8)) + 1;
+  }
+  double best = elapsed;
+  for (int r = 0; r < rounds; r++) {
+    start = now();
+    for (long i = 0; i < repeats; i++) {
+      step->run(work);
+    }
+    elapsed = (now() - start) / repeats;
+    best = elapsed < best ? elapsed : best;
+  }
+  return best;
+}
+
+/**
+Measures the time stamp counter against the clock. The counter ticks at a
+fixed rate close to the nominal core clock, so it stands in for cycles.
+@return counter ticks per second, or 0 where there is no counter
+*/
+static double cyclesPerSecond(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  double start = now();
+  uint64_t ticks = __rdtsc();
+  while (now() - start < 0.05) {
+  }
+  return (__rdtsc() - ticks) / (now() - start);
+#else
+  return 0.0;
+#endif
+}
+
+/**
+Size of an example in readme.md
+@param name is the path of the input
+@return its size in bits, or 0 if the table does not list it
+*/
+static uint64_t referenceBits(const char *name) {
+  const char *base = strrchr(name, '/');
+  base = base != NULL ? base + 1 : name;
+  for (size_t i = 0; i < sizeof(references) / sizeof(references[0]); i++) {
+    if (strcmp(base, references[i].file) == 0) {
+      return references[i].bits;
+    }
+  }
+  return 0;
+}
+
+/**
+Prints one metric as an input,metric,value line
+@param name is the input
+@param metric is the name of the metric
+@param value is its value
+*/
+static void printMetric(const char *name, const char *metric, double value) {
+  printf("%s,%s,%.10g\n", name, metric, value);
+}
+
+/**
+Benchmarks every phase on one input
+@param name is the input, for reports
+@param data is its contents
+@param size is the number of bytes in data
+@param rounds is the number of runs to take the best of
+@param csv is whether to print input,metric,value lines instead of a table
+@param hz is cyclesPerSecond(), or 0 to leave out cycle counts
+@return 0 on success, -1 if the payload did not decode to the input
+*/
+static int benchmark(const char *name, const uint8_t *data, size_t size,
+                     int rounds, int csv, double hz) {
+  subject *work = calloc(1, sizeof(subject));
+  work->data = data;
+  work->size = size;
+  work->encoded = malloc(size * MAX_CODE_LENGTH / 8 + 16);
+  work->decoded = malloc(size > 0 ? size : 1);
+  work->multiDecoded = malloc(size > 0 ? size : 1);
+  double seconds[sizeof(phases) / sizeof(phases[0])];
+  for (size_t p = 0; p < sizeof(phases) / sizeof(phases[0]); p++) {
+    seconds[p] = timePhase(&phases[p], work, rounds);
+  }
+  int status = memcmp(work->decoded, data, size) == 0 &&
+                       memcmp(work->multiDecoded, data, size) == 0
+                   ? 0
+                   : -1;
+
+  uint64_t payloadBits = encodedBits(&work->codes, work->frequencies);
+  double entropy = entropyBits(work->frequencies);
+  uint64_t reference = referenceBits(name);
+  if (csv) {
+    printMetric(name, "bytes", (double)size);
+    printMetric(name, "payload_bits", (double)payloadBits);
+    printMetric(name, "entropy_bits", entropy);
+    if (reference > 0) {
+      printMetric(name, "reference_bits", (double)reference);
+    }
+  } else {
+    printf("%s: %zu bytes, %llu payload bits (%.3f bits/symbol)\n", name, size,
+           (unsigned long long)payloadBits,
+           size > 0 ? (double)payloadBits / size : 0.0);
+    printf("  entropy bound %.0f bits (+%.3f%%)", entropy,
+           entropy > 0 ? 100.0 * payloadBits / entropy - 100.0 : 0.0);
+    if (reference > 0) {
+      printf(", readme.md %llu bits (%+.3f%%)",
+             (unsigned long long)reference,
+             100.0 * payloadBits / reference - 100.0);
+    }
+    printf("\n");
+  }
+  for (size_t p = 0; p < sizeof(phases) / sizeof(phases[0]); p++) {
+    double mbps = seconds[p] > 0 ? size / 1e6 / seconds[p] : 0.0;
+    double nsPerSymbol = size > 0 ? seconds[p] * 1e9 / size : 0.0;
+    double perCycle = seconds[p] > 0 ? size / (seconds[p] * hz) : 0.0;
+    if (csv) {
+      char key[64];
+      snprintf(key, sizeof(key), "%s_mb_per_s", phases[p].name);
+      printMetric(name, key, mbps);
+      snprintf(key, sizeof(key), "%s_ns_per_symbol", phases[p].name);
+      printMetric(name, key, nsPerSymbol);
+      if (hz > 0) {
+        snprintf(key, sizeof(key), "%s_symbols_per_cycle", phases[p].name);
+        printMetric(name, key, perCycle);
+      }
+    } else {
+      printf("  %-14s %10.1f MB/s %10.3f ns/symbol", phases[p].name, mbps,
+             nsPerSymbol);
+      if (hz > 0) {
+        printf(" %8.3f symbols/cycle", perCycle);
+      }
+      printf(" %12.0f ns\n", seconds[p] * 1e9);
+    }
+  }
+  if (status < 0) {
+    fprintf(stderr, "%s: payload does not decode to the input\n", name);
+  }
+  free(work->encoded);
+  free(work->decoded);
+  free(work->multiDecoded);
+  free(work);
+  return status;
+}
+
+/**
+Fills a synthetic input
+@param kind is "uniform" for random bytes, "skewed" for bytes whose
+probability halves with each step away from 'a', or "single" for one repeated
+byte
+@param data receives SYNTHETIC_SIZE bytes
+*/
+static void synthesize(const char *kind, uint8_t *data) {
+  srand(1);
+  for (size_t i = 0; i < SYNTHETIC_SIZE; i++) {
+    if (strcmp(kind, "uniform") == 0) {
+      data[i] = (uint8_t)rand();
+    } else if (strcmp(kind, "skewed") == 0) {
+      int step = 0;
+      while (step < 25 && rand() % 2 == 0) {
+        step++;
+      }
+      data[i] = (uint8_t)('a' + step);
+    } else {
+      data[i] = 'a';
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  int csv = 0, rounds = 5, opt;
+  while ((opt = getopt(argc, argv, "cr:")) != -1) {
+    switch (opt) {
+    case 'c':
+      csv = 1;
+      break;
+    case 'r':
+      rounds = (int)strtol(optarg, NULL, 10);
+      break;
+    default:
+      fprintf(stderr, "Usage: bench/corpusbench [-c] [-r rounds] "
+                      "[files...]\n");
+      return EXIT_FAILURE;
+    }
+  }
+  if (rounds < 1) {
+    rounds = 1;
+  }
+  if (csv) {
+    printf("input,metric,value\n");
+  }
+  double hz = cyclesPerSecond();
+  int status = EXIT_SUCCESS;
+  for (int i = optind; i < argc; i++) {
+    inputSource input;
+    if (openInput(argv[i], &input) < 0) {
+      status = EXIT_FAILURE;
+      continue;
+    }
+    if (benchmark(argv[i], input.data, input.size, rounds, csv, hz) < 0) {
+      status = EXIT_FAILURE;
+    }
+    closeInput(&input);
+  }
+  static const char *kinds[] = {"uniform", "skewed", "single"};
+  uint8_t *data = malloc(SYNTHETIC_SIZE);
+  for (size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); k++) {
+    char name[32];
+    snprintf(name, sizeof(name), "synthetic:%s", kinds[k]);
+    synthesize(kinds[k], data);
+    if (benchmark(name, data, SYNTHETIC_SIZE, rounds, csv, hz) < 0) {
+      status = EXIT_FAILURE;
+    }
+  }
+  free(data);
+  return status;
+}
@@ -0,0 +1,126 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        Microbenchmark of the two heaps. Builds the same huffman trees with
+        the binary heap of node indices in heap.h, one insert at a time,
+        and with buildHuffmanTree(), which heapifies a 4-ary heap of inline
+        weights. Also times a plain fill and drain of each heap.
+
+        Usage: bench/heapbench [file] [rounds]
+          file      frequencies to build trees for (default: random)
+          rounds    number of trees per measurement (default 100000)
+ */
+#include "dheap.h"
+#include "encoder.h"
+#include "heap.h"
+#include "histogram.h"
+#include "huffman.h"
+#include "input.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+Builds a huffman tree with the binary heap, one insert per symbol
+@param frequencies is the number of times each symbol appears
+@param tree receives the tree
+*/
+static void buildWithBinaryHeap(const uint64_t *frequencies, heap *tree) {
+  makenull(tree, ALPHABET_SIZE);
+  for (int asciiValue = 0; asciiValue < ALPHABET_SIZE; asciiValue++) {
+    if (frequencies[asciiValue] != 0) {
+      insert(frequencies[asciiValue], asciiValue, tree);
+    }
+  }
+  while (tree->currentSize > 1) {
+    int node01 = extractMin(tree);
+    int node02 = extractMin(tree);
+    insertNode(combineNodes(tree, node01, node02), tree);
+  }
+}
+
+/**
+Prints one measurement
+@param name is what was measured
+@param seconds is the time taken
+@param rounds is the number of repetitions
+*/
+static void report(const char *name, double seconds, long rounds) {
+  printf("%-28s %9.1f ns/round\n", name, seconds * 1e9 / rounds);
+}
+
+int main(int argc, char **argv) {
+  uint64_t frequencies[ALPHABET_SIZE] = {0};
+  long rounds = argc > 2 ? strtol(argv[2], NULL, 10) : 100000;
+  if (argc > 1) {
+    inputSource input;
+    if (openInput(argv[1], &input) < 0) {
+      return EXIT_FAILURE;
+    }
+    countBytes(input.data, input.size, frequencies);
+    closeInput(&input);
+  } else {
+    srand(1);
+    for (int i = 0; i < ALPHABET_SIZE; i++) {
+      frequencies[i] = 1 + rand() % 100000;
+    }
+  }
+  if (rounds < 1) {
+    rounds = 1;
+  }
+
+  heap tree;
+  codeTable binaryTable, quadTable;
+  buildWithBinaryHeap(frequencies, &tree);
+  buildCodeTable(&tree, &binaryTable);
+  buildHuffmanTree(frequencies, ALPHABET_SIZE, &tree);
+  buildCodeTable(&tree, &quadTable);
+  printf("payload bits: binary heap %llu, 4-ary heap %llu\n",
+         (unsigned long long)encodedBits(&binaryTable, frequencies),
+         (unsigned long long)encodedBits(&quadTable, frequencies));
+
+  /* Keep the compiler from dropping the builds */
+  uint64_t sink = 0;
+  double start = now();
+  for (long r = 0; r < rounds; r++) {
+    buildWithBinaryHeap(frequencies, &tree);
+    sink += tree.nodeCount;
+  }
+  report("tree, binary heap", now() - start, rounds);
+  start = now();
+  for (long r = 0; r < rounds; r++) {
+    buildHuffmanTree(frequencies, ALPHABET_SIZE, &tree);
+    sink += tree.nodeCount;
+  }
+  report("tree, 4-ary heap", now() - start, rounds);
+
+  /* Fill and drain with the same 256 keys */
+  start = now();
+  for (long r = 0; r < rounds; r++) {
+    makenull(&tree, ALPHABET_SIZE);
+    for (int i = 0; i < ALPHABET_SIZE; i++) {
+      insert(frequencies[i], i, &tree);
+    }
+    while (!empty(&tree)) {
+      sink += extractMin(&tree);
+    }
+  }
+  report("fill and drain, binary heap", now() - start, rounds);
+  heapItem storage[ALPHABET_SIZE];
+  dHeap queue;
+  start = now();
+  for (long r = 0; r < rounds; r++) {
+    initDHeap(&queue, storage, ALPHABET_SIZE);
+    for (int i = 0; i < ALPHABET_SIZE; i++) {
+      addItem(&queue, frequencies[i], i);
+    }
+    heapify(&queue);
+    while (queue.size > 0) {
+      sink += itemIndex(popItem(&queue));
+    }
+  }
+  report("fill and drain, 4-ary heap", now() - start, rounds);
+  return sink == 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
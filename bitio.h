@@ -0,0 +1,199 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file contains a 64-bit accumulating bit writer used to pack
+        huffman codes into bytes and the matching bit reader. Codes are
+        written most significant bit first, so the first bit of the stream
+        is the top bit of byte 0. The hot functions are static inline since
+        they run once per symbol.
+
+*/
+
+#ifndef _BITIO_H_
+#define _BITIO_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Bytes past the end of the stream that putWideBits() may overwrite */
+#define BIT_WRITER_SLACK 8
+
+/**
+Bit writer which collects codes in a 64-bit accumulator and spills them to
+memory 32 bits at a time. The caller guarantees that the output buffer is large
+enough for everything that is written, plus BIT_WRITER_SLACK bytes.
+*/
+typedef struct BitWriter {
+  uint8_t *start;  /**< First byte of the output buffer */
+  uint8_t *ptr;    /**< Next byte to be written */
+  uint64_t buffer; /**< Pending bits, right aligned */
+  int count;       /**< Number of pending bits in buffer, always < 32 */
+} bitWriter;
+
+/**
+ Start writing bits at the beginning of a buffer
+ @param writer is the bit writer to initialize
+ @param out is the output buffer
+ */
+static inline void bitWriterInit(bitWriter *writer, uint8_t *out) {
+  writer->start = out;
+  writer->ptr = out;
+  writer->buffer = 0;
+  writer->count = 0;
+}
+
+/**
+ Append a code to the stream
+ @param writer is the bit writer to append to
+ @param code is the code, right aligned
+ @param length is the number of bits in code, at most 32
+ */
+static inline void putBits(bitWriter *writer, uint64_t code, int length) {
+  writer->buffer = (writer->buffer << length) | code;
+  writer->count += length;
+  if (writer->count >= 32) {
+    writer->count -= 32;
+    uint32_t word = (uint32_t)(writer->buffer >> writer->count);
+    writer->ptr[0] = (uint8_t)(word >> 24);
+    writer->ptr[1] = (uint8_t)(word >> 16);
+    writer->ptr[2] = (uint8_t)(word >> 8);
+    writer->ptr[3] = (uint8_t)word;
+    writer->ptr += 4;
+  }
+}
+
+/**
+ Store 8 bytes as a big endian value
+ @param out is where to write
+ @param value is the value
+ */
+static inline void store64be(uint8_t *out, uint64_t value) {
+  value = __builtin_bswap64(value);
+  memcpy(out, &value, sizeof(value));
+}
+
+/**
+ Append up to 56 bits and write out every complete byte without branching. The
+ pending bits are always stored as 8 bytes and the pointer moves past the
+ complete ones, so up to BIT_WRITER_SLACK bytes past the stream get
+ overwritten.
+ @param writer is the bit writer to append to, with fewer than 8 pending bits
+ @param code is the bits, right aligned
+ @param length is the number of bits in code, at most 56
+ */
+static inline void putWideBits(bitWriter *writer, uint64_t code, int length) {
+  writer->buffer = (writer->buffer << length) | code;
+  writer->count += length;
+  /* count is at most 63, so shift in two steps to allow a count of 0 */
+  store64be(writer->ptr, writer->buffer << (63 - writer->count) << 1);
+  writer->ptr += writer->count >> 3;
+  writer->count &= 7;
+}
+
+/**
+ Write out every complete byte that is still in the accumulator. Up to seven
+ bits may remain pending afterwards.
+ @param writer is the bit writer to drain
+ */
+static inline void drainBits(bitWriter *writer) {
+  while (writer->count >= 8) {
+    writer->count -= 8;
+    *writer->ptr++ = (uint8_t)(writer->buffer >> writer->count);
+  }
+}
+
+/**
+ Pad the stream with zero bits up to the next byte boundary and write it out
+ @param writer is the bit writer to finish
+ @return number of bytes written since bitWriterInit()
+ */
+static inline size_t finishBits(bitWriter *writer) {
+  drainBits(writer);
+  if (writer->count > 0) {
+    *writer->ptr++ = (uint8_t)(writer->buffer << (8 - writer->count));
+    writer->count = 0;
+  }
+  return (size_t)(writer->ptr - writer->start);
+}
+
+/**
+Bit reader which keeps between 56 and 63 unread bits left aligned in a 64-bit
+buffer after every refill. Reading past the end of the input yields zero bits.
+*/
+typedef struct BitReader {
+  const uint8_t *ptr; /**< Next byte to load into the buffer */
+  const uint8_t *end; /**< One past the last byte of the input */
+  uint64_t buffer;    /**< Unread bits, left aligned */
+  int count;          /**< Number of valid bits in buffer */
+} bitReader;
+
+/**
+ Load 8 bytes as a big endian value
+ @param in is where to read from
+ @return the value
+ */
+static inline uint64_t load64be(const uint8_t *in) {
+  uint64_t value;
+  memcpy(&value, in, sizeof(value));
+  return __builtin_bswap64(value);
+}
+
+/**
+ Start reading bits at the beginning of a buffer
+ @param reader is the bit reader to initialize
+ @param in is the input buffer
+ @param size is the number of bytes in the input buffer
+ */
+static inline void bitReaderInit(bitReader *reader, const uint8_t *in,
+                                 size_t size) {
+  reader->ptr = in;
+  reader->end = in + size;
+  reader->buffer = 0;
+  reader->count = 0;
+}
+
+/**
+ Top up the buffer so that at least 56 bits can be peeked. Away from the end of
+ the input this is a single unaligned load; bits below the valid count are the
+ start of the next byte, so loading them again later is harmless.
+ @param reader is the bit reader to refill
+ */
+static inline void refillBits(bitReader *reader) {
+  if (reader->end - reader->ptr >= 8) {
+    reader->buffer |= load64be(reader->ptr) >> reader->count;
+    reader->ptr += (63 - reader->count) >> 3;
+    reader->count |= 56;
+    return;
+  }
+  while (reader->count <= 56) {
+    uint64_t byte = reader->ptr < reader->end ? *reader->ptr++ : 0;
+    reader->buffer |= byte << (56 - reader->count);
+    reader->count += 8;
+  }
+}
+
+/**
+ Look at the next bits without consuming them
+ @param reader is the bit reader to peek into
+ @param length is the number of bits, between 1 and the buffered count
+ @return the bits, right aligned
+ */
+static inline uint32_t peekBits(const bitReader *reader, int length) {
+  return (uint32_t)(reader->buffer >> (64 - length));
+}
+
+/**
+ Consume bits that were previously peeked
+ @param reader is the bit reader to advance
+ @param length is the number of bits to drop
+ */
+static inline void skipBits(bitReader *reader, int length) {
+  reader->buffer <<= length;
+  reader->count -= length;
+}
+
+#endif
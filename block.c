@@ -0,0 +1,538 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file implements block frames: a histogram, a code table and a
+        huffman coded payload per block. The table may be left out when an
+        earlier frame's table is as good. The payload may be split into
+        several streams that share the table, so the decoder can work on
+        them in lockstep, or be coded with a table per preceding byte. A
+        block that no code makes smaller is stored as it is, and a block of
+        one byte value as that byte.
+
+ */
+#include "block.h"
+#include "bitio.h"
+#include "decoder.h"
+#include "format.h"
+#include "histogram.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+Builds a canonical code table whose codes fit in the configured limit. The
+unconstrained optimum is computed first and only replaced by package merge
+lengths when it is too deep.
+@param frequencies is the symbol count of the block
+@param options selects the builder and the code length limit
+@param table is the code table to fill
+@param optimalBits receives the payload size of the unconstrained code
+@return 0 on success, -1 if the limit is too small for the alphabet
+*/
+static int buildBoundedTable(const uint64_t *frequencies,
+                             const encoderOptions *options, codeTable *table,
+                             uint64_t *optimalBits) {
+  int maxLength;
+  if (options->builder == BUILD_HEAP) {
+    heap tree;
+    buildHuffmanTree(frequencies, ALPHABET_SIZE, &tree);
+    maxLength = buildCodeTable(&tree, table);
+  } else {
+    maxLength = computeCodeLengths(frequencies, ALPHABET_SIZE, table);
+  }
+  *optimalBits = encodedBits(table, frequencies);
+  if (maxLength > options->maxCodeLength &&
+      limitCodeLengths(frequencies, ALPHABET_SIZE, options->maxCodeLength,
+                       table) < 0) {
+    return -1;
+  }
+  assignCanonicalCodes(table);
+  return 0;
+}
+
+/**
+Size of the code length header of a table
+@param table is the code table
+@return the number of bytes writeCodeLengths() writes for it
+*/
+static size_t lengthsSize(const codeTable *table) {
+  uint8_t scratch[MAX_LENGTHS_SIZE];
+  return writeCodeLengths(table, scratch);
+}
+
+/**
+Whether a table has a code for every symbol of a histogram
+@param table is the code table
+@param frequencies is the symbol count of a block
+@return 1 if every symbol that appears has a code, 0 otherwise
+*/
+static int coversSymbols(const codeTable *table,
+                         const uint64_t *frequencies) {
+  for (int symbol = 0; symbol < ALPHABET_SIZE; symbol++) {
+    if (frequencies[symbol] > 0 && table->length[symbol] == 0) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/**
+Chooses how to code a block: stored as it is, as a run of one byte value, with
+the last table a frame carried, or with a fresh table. A block is stored
+without building a tree when the entropy bound plus the code lengths of a
+fresh table, and the cost of the last table, are no smaller than the block.
+An order-0 block repeats the last table without building a tree when that
+costs no more than the entropy of the block plus the code lengths a fresh
+table would carry, which no fresh table can beat. Otherwise a fresh table is
+built and the choices are compared exactly. Order-1 blocks with more than one
+byte value are not stored here, since their context tables may still beat
+storing; encodeBlock() checks them once they are coded.
+@param table holds the frequencies of the block and receives its codes
+@param previous is the last table a frame carried, or NULL for none
+@param options are the encoder settings
+@return 0 on success, -1 if the code length limit is too small
+*/
+int chooseBlockTable(blockTable *table, const codeTable *previous,
+                     const encoderOptions *options) {
+  table->repeat = 0;
+  table->type = BLOCK_HUFFMAN;
+  uint64_t size = 0;
+  int symbolCount = 0;
+  for (int symbol = 0; symbol < ALPHABET_SIZE; symbol++) {
+    size += table->frequencies[symbol];
+    symbolCount += table->frequencies[symbol] != 0;
+  }
+  if (symbolCount <= 1) {
+    /* An empty block stores nothing, one byte value stores just itself */
+    table->type = symbolCount == 0 ? BLOCK_RAW : BLOCK_RUN;
+    table->optimalBits = symbolCount == 0 ? 0 : 8;
+    return 0;
+  }
+  /* Bits a huffman frame spends beyond its payload and code lengths */
+  int streams = options->streams > 1 ? options->streams : 1;
+  uint64_t streamBits = streams > 1 ? 8 * (1 + 4 * (uint64_t)(streams - 1)) : 0;
+  uint64_t rawBits = 8 * size;
+  int storable = options->contextOrder == 0;
+  int canRepeat =
+      previous != NULL && coversSymbols(previous, table->frequencies);
+  uint64_t repeatBits =
+      canRepeat ? encodedBits(previous, table->frequencies) : UINT64_MAX;
+  double entropy = entropyBits(table->frequencies);
+  if (storable && (!canRepeat || repeatBits + streamBits >= rawBits) &&
+      entropy + 8.0 * codeLengthsSize(symbolCount) + streamBits >= rawBits) {
+    table->type = BLOCK_RAW;
+    table->optimalBits = rawBits;
+    return 0;
+  }
+  /* No prefix code beats the entropy, and a fresh table's code lengths take
+   * the same size whatever they are, so that is its least cost. Context
+   * tables are not bound by it, so order-1 blocks always build a table. */
+  if (storable && canRepeat && repeatBits + streamBits < rawBits &&
+      repeatBits <= entropy + 8.0 * codeLengthsSize(symbolCount)) {
+    table->codes = *previous;
+    /* No tree was built, so the repeated payload stands in for the optimum */
+    table->optimalBits = repeatBits;
+    table->repeat = 1;
+    return 0;
+  }
+  if (buildBoundedTable(table->frequencies, options, &table->codes,
+                        &table->optimalBits) < 0) {
+    return -1;
+  }
+  uint64_t bestBits = encodedBits(&table->codes, table->frequencies) +
+                      8 * lengthsSize(&table->codes);
+  if (canRepeat && repeatBits <= bestBits) {
+    table->codes = *previous;
+    table->repeat = 1;
+    bestBits = repeatBits;
+  }
+  if (storable && bestBits + streamBits >= rawBits) {
+    table->type = BLOCK_RAW;
+    table->repeat = 0;
+    table->optimalBits = rawBits;
+  }
+  return 0;
+}
+
+/**
+Compresses one block into a BLOCK_CONTEXT frame if that beats a single table.
+A preceding byte only gets a table of its own if its bytes cost less with
+that table and its header than with the single table. All other preceding
+bytes share one table built from their combined counts.
+@param in is the data of the block
+@param size is the number of bytes in the block
+@param options are the encoder settings
+@param order0 is the single table of the block
+@param block receives the frame in block->data
+@return 1 if the frame was written, 0 if the single table is better, -1 if the
+code length limit is too small, or BLOCK_NO_MEMORY
+*/
+static int encodeContextBlock(const uint8_t *in, size_t size,
+                              const encoderOptions *options,
+                              const codeTable *order0, encodedBlock *block) {
+  uint64_t(*counts)[ALPHABET_SIZE] =
+      calloc(ALPHABET_SIZE, sizeof(uint64_t[ALPHABET_SIZE]));
+  codeTable *tables = malloc(sizeof(codeTable) * (ALPHABET_SIZE + 1));
+  codeTable *shared = &tables[ALPHABET_SIZE];
+  const codeTable *tableOf[ALPHABET_SIZE];
+  uint8_t map[CONTEXT_MAP_SIZE] = {0};
+  uint64_t sharedCounts[ALPHABET_SIZE] = {0};
+  uint64_t payloadBits = 0, optimalBits = 0, unused;
+  size_t headerSize = CONTEXT_MAP_SIZE;
+  int status = -1;
+  if (counts == NULL || tables == NULL) {
+    status = BLOCK_NO_MEMORY;
+    goto done;
+  }
+
+  uint8_t previous = 0;
+  for (size_t i = 0; i < size; i++) {
+    counts[previous][in[i]]++;
+    previous = in[i];
+  }
+  for (int context = 0; context < ALPHABET_SIZE; context++) {
+    tableOf[context] = shared;
+    uint64_t sharedBits = encodedBits(order0, counts[context]);
+    if (sharedBits == 0) {
+      continue;
+    }
+    codeTable *own = &tables[context];
+    if (buildBoundedTable(counts[context], options, own, &unused) < 0) {
+      goto done;
+    }
+    uint64_t ownBits = encodedBits(own, counts[context]);
+    size_t ownHeader = lengthsSize(own);
+    if (ownBits + 8 * ownHeader < sharedBits) {
+      map[context >> 3] |= 1 << (context & 7);
+      tableOf[context] = own;
+      headerSize += ownHeader;
+      payloadBits += ownBits;
+      optimalBits += unused;
+    } else {
+      for (int symbol = 0; symbol < ALPHABET_SIZE; symbol++) {
+        sharedCounts[symbol] += counts[context][symbol];
+      }
+    }
+  }
+  if (buildBoundedTable(sharedCounts, options, shared, &unused) < 0) {
+    goto done;
+  }
+  headerSize += lengthsSize(shared);
+  payloadBits += encodedBits(shared, sharedCounts);
+  optimalBits += unused;
+  /* The single table frame would be its header plus block->payloadBits */
+  status = 0;
+  if (8 * headerSize + payloadBits >=
+      8 * lengthsSize(order0) + block->payloadBits) {
+    goto done;
+  }
+
+  block->payloadBits = payloadBits;
+  block->optimalBits = optimalBits;
+  uint8_t *ptr = block->data + BLOCK_HEADER_SIZE;
+  memcpy(ptr, map, CONTEXT_MAP_SIZE);
+  ptr += CONTEXT_MAP_SIZE;
+  ptr += writeCodeLengths(shared, ptr);
+  for (int context = 0; context < ALPHABET_SIZE; context++) {
+    if (tableOf[context] != shared) {
+      ptr += writeCodeLengths(tableOf[context], ptr);
+    }
+  }
+  bitWriter writer;
+  bitWriterInit(&writer, ptr);
+  encodeContextSymbols(tableOf, in, size, &writer);
+  ptr += finishBits(&writer);
+  block->size = (size_t)(ptr - block->data);
+  block->data[0] = BLOCK_CONTEXT;
+  store32(block->data + 1, (uint32_t)(block->size - BLOCK_HEADER_SIZE));
+  status = 1;
+
+done:
+  free(counts);
+  free(tables);
+  return status;
+}
+
+/**
+Largest frame encodeBlock() writes for a block. An optimal code never does
+worse than 8 bits per byte, and a table is only repeated or split by context
+when that is smaller, so the payload is at most the block itself. The bit
+writer may also overwrite a few bytes past the end of the payload.
+@param size is the number of bytes in the block
+@param options are the encoder settings
+@return the number of bytes to allow for the frame
+*/
+size_t blockBound(size_t size, const encoderOptions *options) {
+  int streams = options->streams > 1 ? options->streams : 1;
+  /* Each extra stream adds a size field and up to one byte of padding */
+  return BLOCK_HEADER_SIZE + MAX_LENGTHS_SIZE + size + 5 * (size_t)streams +
+         BIT_WRITER_SLACK;
+}
+
+/**
+Writes a block into a BLOCK_RAW or BLOCK_RUN frame
+@param in is the data of the block
+@param size is the number of bytes in the block
+@param type is BLOCK_RAW, or BLOCK_RUN if every byte of the block is the same
+@param block receives the frame in block->data
+*/
+static void storeBlock(const uint8_t *in, size_t size, int type,
+                       encodedBlock *block) {
+  size_t bodySize = type == BLOCK_RUN ? 1 : size;
+  if (bodySize > 0) {
+    memcpy(block->data + BLOCK_HEADER_SIZE, in, bodySize);
+  }
+  block->data[0] = (uint8_t)type;
+  store32(block->data + 1, (uint32_t)bodySize);
+  block->size = BLOCK_HEADER_SIZE + bodySize;
+  block->payloadBits = 8 * bodySize;
+  block->optimalBits = block->payloadBits;
+}
+
+/**
+Compresses one block into a frame
+@param in is the data of the block
+@param size is the number of bytes in the block
+@param table is the table chooseBlockTable() chose for the block
+@param options are the encoder settings
+@param block receives the frame in block->data, which the caller points at
+blockBound(size, options) bytes
+@return 0 on success, -1 if the code length limit is too small
+*/
+int encodeBlock(const uint8_t *in, size_t size, const blockTable *table,
+                const encoderOptions *options, encodedBlock *block) {
+  if (table->type != BLOCK_HUFFMAN) {
+    storeBlock(in, size, table->type, block);
+    return 0;
+  }
+  const codeTable *codes = &table->codes;
+  block->optimalBits = table->optimalBits;
+  block->payloadBits = encodedBits(codes, table->frequencies);
+  int streams = options->streams > 1 ? options->streams : 1;
+  if (options->contextOrder == 1 && size > 0 && !table->repeat) {
+    int status = encodeContextBlock(in, size, options, codes, block);
+    if (status < 0) {
+      return status;
+    }
+    if (status > 0) {
+      if (block->size > BLOCK_HEADER_SIZE + size) {
+        storeBlock(in, size, BLOCK_RAW, block);
+      }
+      return 0;
+    }
+    /* chooseBlockTable() left the single table frame to be checked here */
+    uint64_t streamBits =
+        streams > 1 ? 8 * (1 + 4 * (uint64_t)(streams - 1)) : 0;
+    if (block->payloadBits + 8 * lengthsSize(codes) + streamBits >= 8 * size) {
+      storeBlock(in, size, BLOCK_RAW, block);
+      return 0;
+    }
+  }
+  uint8_t *ptr = block->data + BLOCK_HEADER_SIZE;
+  if (!table->repeat) {
+    ptr += writeCodeLengths(codes, ptr);
+  }
+  bitWriter writer;
+  if (streams == 1) {
+    bitWriterInit(&writer, ptr);
+    encodeSymbols(codes, in, size, &writer);
+    ptr += finishBits(&writer);
+    block->data[0] = BLOCK_HUFFMAN;
+  } else {
+    uint8_t *jumpTable = ptr + 1;
+    *ptr = (uint8_t)streams;
+    ptr = jumpTable + 4 * (streams - 1);
+    for (int k = 0; k < streams; k++) {
+      size_t start = streamStart(size, streams, k);
+      size_t end = streamStart(size, streams, k + 1);
+      bitWriterInit(&writer, ptr);
+      encodeSymbols(codes, in + start, end - start, &writer);
+      size_t streamSize = finishBits(&writer);
+      if (k < streams - 1) {
+        store32(jumpTable + 4 * k, (uint32_t)streamSize);
+      }
+      ptr += streamSize;
+    }
+    block->data[0] = BLOCK_STREAMS;
+  }
+  if (table->repeat) {
+    block->data[0] |= BLOCK_REPEAT_TABLE;
+  }
+  block->size = (size_t)(ptr - block->data);
+  store32(block->data + 1, (uint32_t)(block->size - BLOCK_HEADER_SIZE));
+  return 0;
+}
+
+/**
+Splits the body of a BLOCK_STREAMS frame into its streams
+@param in is the stream count, jump table and streams
+@param inSize is the number of bytes in the body
+@param outSize is the number of symbols in the block
+@param streams receives the start of each stream
+@param sizes receives the number of bytes in each stream
+@return the number of streams, or -1 if the body is corrupt
+*/
+static int findStreams(const uint8_t *in, size_t inSize, size_t outSize,
+                       const uint8_t **streams, size_t *sizes) {
+  if (inSize < 1 || in[0] < 1 || in[0] > MAX_STREAMS) {
+    return -1;
+  }
+  int count = in[0];
+  size_t tableSize = 1 + 4 * (size_t)(count - 1);
+  if (inSize < tableSize) {
+    return -1;
+  }
+  const uint8_t *ptr = in + tableSize;
+  size_t left = inSize - tableSize;
+  for (int k = 0; k < count; k++) {
+    sizes[k] = k < count - 1 ? load32(in + 1 + 4 * k) : left;
+    /* Every symbol takes at least one bit */
+    size_t symbols =
+        streamStart(outSize, count, k + 1) - streamStart(outSize, count, k);
+    if (sizes[k] > left || symbols > (uint64_t)sizes[k] * 8) {
+      return -1;
+    }
+    streams[k] = ptr;
+    ptr += sizes[k];
+    left -= sizes[k];
+  }
+  return count;
+}
+
+/**
+Decompresses the body of a BLOCK_CONTEXT frame
+@param in is the rest of the frame after the block header
+@param inSize is the number of bytes in the rest of the frame
+@param out receives the original data of the block
+@param outSize is the number of bytes in the original block
+@return 0 on success, -1 if the frame is corrupt, or BLOCK_NO_MEMORY
+*/
+static int decodeContextBlock(const uint8_t *in, size_t inSize, uint8_t *out,
+                              size_t outSize) {
+  if (inSize < CONTEXT_MAP_SIZE) {
+    return -1;
+  }
+  const uint8_t *map = in;
+  size_t offset = CONTEXT_MAP_SIZE;
+  /* The shared table goes last, after the own tables */
+  decodeTable *tables = malloc(sizeof(decodeTable) * (ALPHABET_SIZE + 1));
+  if (tables == NULL) {
+    return BLOCK_NO_MEMORY;
+  }
+  decodeTable *shared = &tables[ALPHABET_SIZE];
+  const decodeTable *tableOf[ALPHABET_SIZE];
+  codeTable codes;
+  int status = -1;
+  size_t size = readCodeLengths(in + offset, inSize - offset, &codes);
+  if (size == 0) {
+    goto done;
+  }
+  offset += size;
+  buildDecodeTable(&codes, shared);
+  for (int context = 0; context < ALPHABET_SIZE; context++) {
+    tableOf[context] = shared;
+    if (map[context >> 3] & (1 << (context & 7))) {
+      size = readCodeLengths(in + offset, inSize - offset, &codes);
+      if (size == 0) {
+        goto done;
+      }
+      offset += size;
+      buildDecodeTable(&codes, &tables[context]);
+      tableOf[context] = &tables[context];
+    }
+  }
+  /* Every symbol takes at least one bit */
+  if (outSize > (uint64_t)(inSize - offset) * 8) {
+    goto done;
+  }
+  decodeContextSymbols(tableOf, in + offset, inSize - offset, out, outSize);
+  status = 0;
+
+done:
+  free(tables);
+  return status;
+}
+
+/**
+Decompresses the body of one frame
+@param type is the block type from the frame header
+@param table is the body of the frame that holds the code lengths when the
+type has the BLOCK_REPEAT_TABLE flag, otherwise NULL
+@param tableSize is the number of bytes in table
+@param in is the rest of the frame after the block header
+@param inSize is the number of bytes in the rest of the frame
+@param out receives the original data of the block
+@param outSize is the number of bytes in the original block
+@return 0 on success, -1 if the frame is corrupt, or BLOCK_NO_MEMORY
+*/
+int decodeBlock(int type, const uint8_t *table, size_t tableSize,
+                const uint8_t *in, size_t inSize, uint8_t *out,
+                size_t outSize) {
+  if (type == BLOCK_CONTEXT) {
+    return decodeContextBlock(in, inSize, out, outSize);
+  }
+  if (type == BLOCK_RAW || type == BLOCK_RUN) {
+    if (inSize != (type == BLOCK_RUN ? 1 : outSize)) {
+      return -1;
+    }
+    if (type == BLOCK_RUN) {
+      memset(out, in[0], outSize);
+    } else if (outSize > 0) {
+      memcpy(out, in, outSize);
+    }
+    return 0;
+  }
+  int repeat = (type & BLOCK_REPEAT_TABLE) != 0;
+  type &= ~BLOCK_REPEAT_TABLE;
+  if (type != BLOCK_HUFFMAN && type != BLOCK_STREAMS) {
+    return -1;
+  }
+  if (!repeat) {
+    table = in;
+    tableSize = inSize;
+  }
+  codeTable codes;
+  size_t lengthsSize = readCodeLengths(table, tableSize, &codes);
+  if (lengthsSize == 0) {
+    return -1;
+  }
+  if (!repeat) {
+    in += lengthsSize;
+    inSize -= lengthsSize;
+  }
+  const uint8_t *streams[MAX_STREAMS] = {in};
+  size_t sizes[MAX_STREAMS] = {inSize};
+  int streamCount = 1;
+  if (type == BLOCK_STREAMS) {
+    streamCount = findStreams(in, inSize, outSize, streams, sizes);
+    if (streamCount < 0) {
+      return -1;
+    }
+  } else if (outSize > (uint64_t)sizes[0] * 8) {
+    /* Every symbol takes at least one bit */
+    return -1;
+  }
+  if (outSize == 0) {
+    return 0;
+  }
+  if (outSize >= MULTI_MIN_SYMBOLS) {
+    multiDecodeTable *decoder = malloc(sizeof(multiDecodeTable));
+    if (decoder == NULL) {
+      return BLOCK_NO_MEMORY;
+    }
+    buildMultiDecodeTable(&codes, decoder);
+    decodeMultiStreams(decoder, streams, sizes, streamCount, out, outSize);
+    free(decoder);
+    return 0;
+  }
+  decodeTable *decoder = malloc(sizeof(decodeTable));
+  if (decoder == NULL) {
+    return BLOCK_NO_MEMORY;
+  }
+  buildDecodeTable(&codes, decoder);
+  decodeStreams(decoder, streams, sizes, streamCount, out, outSize);
+  free(decoder);
+  return 0;
+}
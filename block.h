@@ -0,0 +1,106 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file contains the interface for compressing and decompressing
+        a single block. Code tables are chosen in block order, since a
+        block may repeat the table of an earlier block instead of carrying
+        its own; once chosen, blocks are coded independently of each other
+        and in any order.
+
+*/
+
+#ifndef _BLOCK_H_
+#define _BLOCK_H_
+
+#include "encoder.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/** Returned by encodeBlock() and decodeBlock() when memory runs out */
+#define BLOCK_NO_MEMORY -2
+
+/**
+A compressed block frame, ready to be written out
+*/
+typedef struct EncodedBlock {
+  uint8_t *data;        /**< The frame, including the block header */
+  size_t size;          /**< Number of bytes in data */
+  uint64_t payloadBits; /**< Bits of huffman coded data */
+  uint64_t optimalBits; /**< Payload bits without a code length limit */
+} encodedBlock;
+
+/**
+The code table of a block, chosen before the block is coded
+*/
+typedef struct BlockTable {
+  uint64_t frequencies[ALPHABET_SIZE]; /**< Symbol counts of the block */
+  codeTable codes;                     /**< Codes the block is coded with */
+  uint64_t optimalBits; /**< Payload bits without a code length limit */
+  int repeat;           /**< 1 if codes are an earlier block's table */
+  int type; /**< BLOCK_HUFFMAN to code the block, or BLOCK_RAW or BLOCK_RUN
+                 to store it, in which case codes are not set */
+} blockTable;
+
+/**
+Chooses how to code a block: stored as it is, as a run of one byte value, with
+the last table a frame carried, or with a fresh table. A block is stored
+without building a tree when the entropy bound plus the code lengths of a
+fresh table, and the cost of the last table, are no smaller than the block.
+An order-0 block repeats the last table without building a tree when that
+costs no more than the entropy of the block plus the code lengths a fresh
+table would carry, which no fresh table can beat. Otherwise a fresh table is
+built and the choices are compared exactly. Order-1 blocks with more than one
+byte value are not stored here, since their context tables may still beat
+storing; encodeBlock() checks them once they are coded.
+@param table holds the frequencies of the block and receives its codes
+@param previous is the last table a frame carried, or NULL for none
+@param options are the encoder settings
+@return 0 on success, -1 if the code length limit is too small
+*/
+int chooseBlockTable(blockTable *table, const codeTable *previous,
+                     const encoderOptions *options);
+
+/**
+Largest frame encodeBlock() writes for a block. An optimal code never does
+worse than 8 bits per byte, and a table is only repeated or split by context
+when that is smaller, so the payload is at most the block itself.
+@param size is the number of bytes in the block
+@param options are the encoder settings
+@return the number of bytes to allow for the frame
+*/
+size_t blockBound(size_t size, const encoderOptions *options);
+
+/**
+Compresses one block into a frame
+@param in is the data of the block
+@param size is the number of bytes in the block
+@param table is the table chooseBlockTable() chose for the block
+@param options are the encoder settings
+@param block receives the frame in block->data, which the caller points at
+blockBound(size, options) bytes
+@return 0 on success, -1 if the code length limit is too small, or
+BLOCK_NO_MEMORY
+*/
+int encodeBlock(const uint8_t *in, size_t size, const blockTable *table,
+                const encoderOptions *options, encodedBlock *block);
+
+/**
+Decompresses the body of one frame
+@param type is the block type from the frame header
+@param table is the body of the frame that holds the code lengths when the
+type has the BLOCK_REPEAT_TABLE flag, otherwise NULL
+@param tableSize is the number of bytes in table
+@param in is the rest of the frame after the block header
+@param inSize is the number of bytes in the rest of the frame
+@param out receives the original data of the block
+@param outSize is the number of bytes in the original block
+@return 0 on success, -1 if the frame is corrupt, or BLOCK_NO_MEMORY
+*/
+int decodeBlock(int type, const uint8_t *table, size_t tableSize,
+                const uint8_t *in, size_t inSize, uint8_t *out,
+                size_t outSize);
+
+#endif
@@ -0,0 +1,472 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file implements in memory compression and decompression of
+        block streams. Blocks are coded with the same frames as compressed
+        files; each frame is preceded by the size of its block instead of
+        being found through an index, and a repeated table always refers
+        to the last frame that carried one.
+
+ */
+#include "codec.h"
+#include "block.h"
+#include "format.h"
+#include "histogram.h"
+#include "stats.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+State of a compressor
+*/
+struct Compressor {
+  encoderOptions options; /**< Encoder settings */
+  uint8_t *pending;       /**< Start of a block that is not complete yet */
+  size_t pendingSize;     /**< Number of bytes in pending */
+  int started;            /**< Whether the stream header was written */
+  blockTable table;       /**< Histogram and table of the current block */
+  codeTable previous;     /**< Last table a frame carried */
+  int havePrevious;       /**< Whether previous holds a table */
+};
+
+/** What a decompressor reads next */
+enum { EXPECT_HEADER, EXPECT_BLOCK, EXPECT_FRAME, EXPECT_NOTHING };
+
+/**
+State of a decompressor
+*/
+struct Decompressor {
+  int state;         /**< One of the EXPECT_ values */
+  uint8_t head[BLOCK_PREFIX_SIZE + BLOCK_HEADER_SIZE]; /**< Header gathered */
+  size_t headSize;   /**< Number of bytes in head */
+  size_t blockSize;  /**< Block size of the stream */
+  size_t blockBytes; /**< Original bytes of the current block */
+  int type;          /**< Type of the current frame */
+  size_t frameSize;  /**< Bytes in the current frame after its header */
+  size_t frameBound; /**< Largest frame the stream may hold */
+  uint8_t *frame;    /**< Current frame, when it arrives in pieces */
+  size_t frameFill;  /**< Number of bytes in frame */
+  uint8_t table[MAX_LENGTHS_SIZE]; /**< Code lengths of the last table */
+  size_t tableSize;  /**< Number of bytes in table, 0 for none yet */
+  uint8_t *block;    /**< Block that did not fit the caller's buffer */
+  size_t blockFill;  /**< Number of bytes in block */
+  size_t blockTaken; /**< Bytes of block handed out so far */
+};
+
+/**
+Creates a compression context. Blocks are coded on the calling thread, so
+options->threads is ignored; use one context per thread instead.
+@param options are the encoder settings, or NULL for the defaults
+@return the context, or NULL if the options are invalid or there is no memory
+*/
+compressor *createCompressor(const encoderOptions *options) {
+  compressor *c = malloc(sizeof(compressor));
+  if (c == NULL) {
+    return NULL;
+  }
+  if (options != NULL) {
+    c->options = *options;
+  } else {
+    defaultEncoderOptions(&c->options);
+  }
+  if (checkEncoderOptions(&c->options) != NULL) {
+    free(c);
+    return NULL;
+  }
+  c->pending = malloc((size_t)c->options.blockSize);
+  if (c->pending == NULL) {
+    free(c);
+    return NULL;
+  }
+  c->pendingSize = 0;
+  c->started = 0;
+  c->havePrevious = 0;
+  return c;
+}
+
+/**
+Frees a compression context
+@param c is the context to free, may be NULL
+*/
+void freeCompressor(compressor *c) {
+  if (c != NULL) {
+    free(c->pending);
+    free(c);
+  }
+}
+
+/**
+Room compressUpdate() needs for an input, which also covers a compressEnd()
+right after it
+@param c is the context
+@param size is the number of input bytes
+@return the number of bytes to allow for the output
+*/
+size_t compressBound(const compressor *c, size_t size) {
+  size_t blockSize = (size_t)c->options.blockSize;
+  /* Every complete block and the partial one left over */
+  size_t blocks = (c->pendingSize + size) / blockSize + 1;
+  return (c->started ? 0 : BLOCK_STREAM_HEADER_SIZE) +
+         blocks * (BLOCK_PREFIX_SIZE + blockBound(blockSize, &c->options)) +
+         BLOCK_PREFIX_SIZE;
+}
+
+/**
+Writes the stream header unless it was written already
+@param c is the context
+@param out is where to write it
+@return the number of bytes written
+*/
+static size_t startStream(compressor *c, uint8_t *out) {
+  if (c->started) {
+    return 0;
+  }
+  storeMagic(out, MAGIC_BLOCKS);
+  store32(out + 4, (uint32_t)c->options.blockSize);
+  c->started = 1;
+  return BLOCK_STREAM_HEADER_SIZE;
+}
+
+/**
+Compresses one block into a frame preceded by its size
+@param c is the context
+@param in is the data of the block
+@param size is the number of bytes in the block
+@param out is where to write at most BLOCK_PREFIX_SIZE + blockBound() bytes
+@return the number of bytes written, or -1 if the code length limit is too
+small
+*/
+static int64_t writeBlock(compressor *c, const uint8_t *in, size_t size,
+                          uint8_t *out) {
+  blockTable *table = &c->table;
+  memset(table->frequencies, 0, sizeof(table->frequencies));
+  countBytes(in, size, table->frequencies);
+  uint64_t start = startPhase();
+  int status = chooseBlockTable(table, c->havePrevious ? &c->previous : NULL,
+                                &c->options);
+  endPhase(PHASE_TREE, start);
+  if (status < 0) {
+    return -1;
+  }
+  encodedBlock block;
+  block.data = out + BLOCK_PREFIX_SIZE;
+  start = startPhase();
+  status = encodeBlock(in, size, table, &c->options, &block);
+  endPhase(PHASE_ENCODE, start);
+  if (status < 0) {
+    return -1;
+  }
+  countStat(COUNTER_BLOCKS, 1);
+  countStat(COUNTER_REPEATED_TABLES, table->repeat);
+  store32(out, (uint32_t)size);
+  /* As in compressFile(), a context frame may replace the chosen table */
+  if (!table->repeat && c->options.contextOrder == 0 &&
+      table->type == BLOCK_HUFFMAN) {
+    c->previous = table->codes;
+    c->havePrevious = 1;
+  }
+  return BLOCK_PREFIX_SIZE + (int64_t)block.size;
+}
+
+/**
+Compresses more input. Every block the input completes is written to out;
+the rest is kept until the next call.
+@param c is the context
+@param in is the input
+@param size is the number of bytes in the input
+@param out receives the compressed bytes
+@param capacity is the room in out, at least compressBound(c, size)
+@return the number of bytes written to out, or -1 if out is too small or the
+code length limit is too small for the input
+*/
+int64_t compressUpdate(compressor *c, const uint8_t *in, size_t size,
+                       uint8_t *out, size_t capacity) {
+  if (capacity < compressBound(c, size)) {
+    return -1;
+  }
+  countStat(COUNTER_BYTES_IN, size);
+  size_t blockSize = (size_t)c->options.blockSize;
+  uint8_t *ptr = out + startStream(c, out);
+  while (size > 0) {
+    const uint8_t *block = in;
+    if (c->pendingSize > 0 || size < blockSize) {
+      size_t take = blockSize - c->pendingSize;
+      take = take < size ? take : size;
+      memcpy(c->pending + c->pendingSize, in, take);
+      c->pendingSize += take;
+      in += take;
+      size -= take;
+      if (c->pendingSize < blockSize) {
+        break;
+      }
+      block = c->pending;
+      c->pendingSize = 0;
+    } else {
+      /* A whole block in the caller's buffer is coded where it is */
+      in += blockSize;
+      size -= blockSize;
+    }
+    int64_t written = writeBlock(c, block, blockSize, ptr);
+    if (written < 0) {
+      return -1;
+    }
+    ptr += written;
+  }
+  countStat(COUNTER_BYTES_OUT, (uint64_t)(ptr - out));
+  return ptr - out;
+}
+
+/**
+Ends a block stream: writes the last partial block and the end marker. The
+context can then start another stream.
+@param c is the context
+@param out receives the compressed bytes
+@param capacity is the room in out, at least compressBound(c, 0)
+@return the number of bytes written to out, or -1 if out is too small or the
+code length limit is too small for the input
+*/
+int64_t compressEnd(compressor *c, uint8_t *out, size_t capacity) {
+  if (capacity < compressBound(c, 0)) {
+    return -1;
+  }
+  uint8_t *ptr = out + startStream(c, out);
+  if (c->pendingSize > 0) {
+    int64_t written = writeBlock(c, c->pending, c->pendingSize, ptr);
+    if (written < 0) {
+      return -1;
+    }
+    ptr += written;
+  }
+  store32(ptr, 0);
+  ptr += BLOCK_PREFIX_SIZE;
+  c->pendingSize = 0;
+  c->started = 0;
+  c->havePrevious = 0;
+  countStat(COUNTER_BYTES_OUT, (uint64_t)(ptr - out));
+  return ptr - out;
+}
+
+/**
+Creates a decompression context
+@return the context, or NULL if there is no memory
+*/
+decompressor *createDecompressor(void) {
+  decompressor *d = calloc(1, sizeof(decompressor));
+  if (d == NULL) {
+    return NULL;
+  }
+  d->state = EXPECT_HEADER;
+  return d;
+}
+
+/**
+Frees a decompression context
+@param d is the context to free, may be NULL
+*/
+void freeDecompressor(decompressor *d) {
+  if (d != NULL) {
+    free(d->frame);
+    free(d->block);
+    free(d);
+  }
+}
+
+/**
+Moves input into the header buffer until it holds a number of bytes
+@param d is the context
+@param need is the number of bytes the header buffer should hold
+@param in is the input, advanced past the bytes used
+@param size is the number of input bytes, reduced by the bytes used
+@return 1 if the header buffer holds need bytes, 0 if the input ran out
+*/
+static int gather(decompressor *d, size_t need, const uint8_t **in,
+                  size_t *size) {
+  if (d->headSize < need) {
+    size_t take = need - d->headSize < *size ? need - d->headSize : *size;
+    memcpy(d->head + d->headSize, *in, take);
+    d->headSize += take;
+    *in += take;
+    *size -= take;
+  }
+  return d->headSize >= need;
+}
+
+/**
+Reads the stream header and sets up the buffers for its block size
+@param d is the context, with the header in its header buffer
+@return 0 on success, -1 if it is not a block stream or there is no memory
+*/
+static int readStreamHeader(decompressor *d) {
+  d->blockSize = load32(d->head + 4);
+  if (!checkMagic(d->head, MAGIC_BLOCKS) || d->blockSize < 1 ||
+      d->blockSize > MAX_BLOCK_SIZE) {
+    return -1;
+  }
+  /* Any stream count may have been used */
+  encoderOptions widest;
+  defaultEncoderOptions(&widest);
+  widest.streams = MAX_STREAMS;
+  d->frameBound = blockBound(d->blockSize, &widest) - BLOCK_HEADER_SIZE;
+  free(d->frame);
+  free(d->block);
+  d->frame = malloc(d->frameBound);
+  d->block = malloc(d->blockSize);
+  d->tableSize = 0;
+  return d->frame != NULL && d->block != NULL ? 0 : -1;
+}
+
+/**
+Decodes the current frame and keeps its code lengths for frames that repeat
+them
+@param d is the context
+@param frame is the frame after its block header
+@param out receives the original bytes of the block
+@return 0 on success, -1 if the frame is corrupt
+*/
+static int decodeFrame(decompressor *d, const uint8_t *frame, uint8_t *out) {
+  const uint8_t *table = NULL;
+  if (d->type & BLOCK_REPEAT_TABLE) {
+    if (d->tableSize == 0) {
+      return -1;
+    }
+    table = d->table;
+  }
+  uint64_t start = startPhase();
+  int status = decodeBlock(d->type, table, d->tableSize, frame, d->frameSize,
+                           out, d->blockBytes);
+  endPhase(PHASE_DECODE, start);
+  if (status < 0) {
+    return -1;
+  }
+  countStat(COUNTER_BLOCKS, 1);
+  if (d->type == BLOCK_HUFFMAN || d->type == BLOCK_STREAMS) {
+    codeTable codes;
+    d->tableSize = readCodeLengths(frame, d->frameSize, &codes);
+    memcpy(d->table, frame, d->tableSize);
+  }
+  return 0;
+}
+
+/**
+Decompresses more input. A block is decoded straight into out when it fits
+and when its frame is whole in the input; otherwise it goes through the
+context and comes out over the following calls. Input is consumed until out
+is full or the stream ends.
+@param d is the context
+@param in is the input
+@param size is the number of bytes in the input
+@param consumed receives the number of input bytes used
+@param out receives the original bytes
+@param capacity is the room in out
+@return the number of bytes written to out, or -1 if the stream is corrupt or
+there is no memory for its buffers
+*/
+int64_t decompressUpdate(decompressor *d, const uint8_t *in, size_t size,
+                         size_t *consumed, uint8_t *out, size_t capacity) {
+  size_t inSize = size;
+  uint8_t *ptr = out;
+  uint8_t *end = out + capacity;
+  int status = 0;
+  for (;;) {
+    /* Hand out what is left of a block decoded earlier */
+    if (d->blockTaken < d->blockFill) {
+      size_t take = d->blockFill - d->blockTaken;
+      take = take < (size_t)(end - ptr) ? take : (size_t)(end - ptr);
+      memcpy(ptr, d->block + d->blockTaken, take);
+      ptr += take;
+      d->blockTaken += take;
+      if (d->blockTaken < d->blockFill) {
+        break;
+      }
+    }
+    if (d->state == EXPECT_HEADER) {
+      if (!gather(d, BLOCK_STREAM_HEADER_SIZE, &in, &size)) {
+        break;
+      }
+      if (readStreamHeader(d) < 0) {
+        status = -1;
+        break;
+      }
+      d->headSize = 0;
+      d->state = EXPECT_BLOCK;
+    } else if (d->state == EXPECT_BLOCK) {
+      if (!gather(d, BLOCK_PREFIX_SIZE, &in, &size)) {
+        break;
+      }
+      d->blockBytes = load32(d->head);
+      if (d->blockBytes == 0) {
+        d->headSize = 0;
+        d->state = EXPECT_NOTHING;
+        break;
+      }
+      if (!gather(d, BLOCK_PREFIX_SIZE + BLOCK_HEADER_SIZE, &in, &size)) {
+        break;
+      }
+      d->type = d->head[BLOCK_PREFIX_SIZE];
+      d->frameSize = load32(d->head + BLOCK_PREFIX_SIZE + 1);
+      if (d->blockBytes > d->blockSize || d->frameSize > d->frameBound) {
+        status = -1;
+        break;
+      }
+      d->headSize = 0;
+      d->frameFill = 0;
+      d->state = EXPECT_FRAME;
+    } else if (d->state == EXPECT_FRAME) {
+      const uint8_t *frame = in;
+      if (d->frameFill == 0 && size >= d->frameSize) {
+        /* The whole frame is in the caller's buffer */
+        in += d->frameSize;
+        size -= d->frameSize;
+      } else {
+        size_t take = d->frameSize - d->frameFill;
+        take = take < size ? take : size;
+        memcpy(d->frame + d->frameFill, in, take);
+        d->frameFill += take;
+        in += take;
+        size -= take;
+        if (d->frameFill < d->frameSize) {
+          break;
+        }
+        frame = d->frame;
+      }
+      int direct = (size_t)(end - ptr) >= d->blockBytes;
+      if (decodeFrame(d, frame, direct ? ptr : d->block) < 0) {
+        status = -1;
+        break;
+      }
+      if (direct) {
+        ptr += d->blockBytes;
+      } else {
+        d->blockFill = d->blockBytes;
+        d->blockTaken = 0;
+      }
+      d->state = EXPECT_BLOCK;
+    } else {
+      break;
+    }
+  }
+  *consumed = inSize - size;
+  countStat(COUNTER_BYTES_IN, *consumed);
+  countStat(COUNTER_BYTES_OUT, (uint64_t)(ptr - out));
+  return status < 0 ? -1 : ptr - out;
+}
+
+/**
+Ends a block stream. The context can then start another stream.
+@param d is the context
+@return 0 if the whole stream was decoded and written out, -1 if it was
+truncated or not all of its output was taken
+*/
+int decompressEnd(decompressor *d) {
+  int status =
+      d->state == EXPECT_NOTHING && d->blockTaken == d->blockFill ? 0 : -1;
+  d->state = EXPECT_HEADER;
+  d->headSize = 0;
+  d->blockFill = 0;
+  d->blockTaken = 0;
+  d->tableSize = 0;
+  return status;
+}
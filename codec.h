@@ -0,0 +1,131 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file contains the library interface for compressing and
+        decompressing in memory, a buffer at a time. The caller owns every
+        buffer: whole blocks are coded straight from the input buffer into
+        the output buffer, and only a partial block is copied aside until
+        the rest of it arrives. The output is a block stream, see
+        format.h, which unlike a compressed file needs no size up front
+        and no seeking.
+
+        Compressing:
+          compressor *c = createCompressor(NULL);
+          for each buffer:
+            out = compressUpdate(c, buffer, size, dst, compressBound(c, size))
+          out = compressEnd(c, dst, compressBound(c, 0))
+          freeCompressor(c)
+
+        Decompressing:
+          decompressor *d = createDecompressor();
+          for each buffer, until it is all consumed:
+            out = decompressUpdate(d, buffer, size, &used, dst, capacity)
+          decompressEnd(d) is 0 if the stream was complete
+          freeDecompressor(d)
+
+*/
+
+#ifndef _CODEC_H_
+#define _CODEC_H_
+
+#include "encoder.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+Compression context for one block stream at a time
+*/
+typedef struct Compressor compressor;
+
+/**
+Decompression context for one block stream at a time
+*/
+typedef struct Decompressor decompressor;
+
+/**
+Creates a compression context. Blocks are coded on the calling thread, so
+options->threads is ignored; use one context per thread instead.
+@param options are the encoder settings, or NULL for the defaults
+@return the context, or NULL if the options are invalid or there is no memory
+*/
+compressor *createCompressor(const encoderOptions *options);
+
+/**
+Frees a compression context
+@param c is the context to free, may be NULL
+*/
+void freeCompressor(compressor *c);
+
+/**
+Room compressUpdate() needs for an input, which also covers a compressEnd()
+right after it
+@param c is the context
+@param size is the number of input bytes
+@return the number of bytes to allow for the output
+*/
+size_t compressBound(const compressor *c, size_t size);
+
+/**
+Compresses more input. Every block the input completes is written to out;
+the rest is kept until the next call.
+@param c is the context
+@param in is the input
+@param size is the number of bytes in the input
+@param out receives the compressed bytes
+@param capacity is the room in out, at least compressBound(c, size)
+@return the number of bytes written to out, or -1 if out is too small
+*/
+int64_t compressUpdate(compressor *c, const uint8_t *in, size_t size,
+                       uint8_t *out, size_t capacity);
+
+/**
+Ends a block stream: writes the last partial block and the end marker. The
+context can then start another stream.
+@param c is the context
+@param out receives the compressed bytes
+@param capacity is the room in out, at least compressBound(c, 0)
+@return the number of bytes written to out, or -1 if out is too small
+*/
+int64_t compressEnd(compressor *c, uint8_t *out, size_t capacity);
+
+/**
+Creates a decompression context
+@return the context, or NULL if there is no memory
+*/
+decompressor *createDecompressor(void);
+
+/**
+Frees a decompression context
+@param d is the context to free, may be NULL
+*/
+void freeDecompressor(decompressor *d);
+
+/**
+Decompresses more input. A block is decoded straight into out when it fits
+and when its frame is whole in the input; otherwise it goes through the
+context and comes out over the following calls. Input is consumed until out
+is full or the stream ends.
+@param d is the context
+@param in is the input
+@param size is the number of bytes in the input
+@param consumed receives the number of input bytes used
+@param out receives the original bytes
+@param capacity is the room in out
+@return the number of bytes written to out, or -1 if the stream is corrupt or
+there is no memory for its buffers
+*/
+int64_t decompressUpdate(decompressor *d, const uint8_t *in, size_t size,
+                         size_t *consumed, uint8_t *out, size_t capacity);
+
+/**
+Ends a block stream. The context can then start another stream.
+@param d is the context
+@return 0 if the whole stream was decoded and written out, -1 if it was
+truncated or not all of its output was taken
+*/
+int decompressEnd(decompressor *d);
+
+#endif
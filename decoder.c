@@ -0,0 +1,814 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file implements the decompressor. The block frames are located
+        through the block index at the end of the file and then decoded in
+        parallel, either all of them or only those covering a byte range.
+        For each block the canonical codes are rebuilt from the code
+        lengths, turned into a decode table, and the payload is decoded one
+        table probe per symbol, or up to MULTI_SYMBOLS symbols per probe
+        once a block is large enough to pay for the multi symbol table.
+
+ */
+#include "decoder.h"
+#include "bitio.h"
+#include "block.h"
+#include "format.h"
+#include "input.h"
+#include "stats.h"
+#include "threadpool.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+Fills a decode table
+@param codes is the canonical code table the data was encoded with
+@param table is the decode table to fill
+*/
+void buildDecodeTable(const codeTable *codes, decodeTable *table) {
+  /* Slots no code maps to only show up in corrupt streams. Give them a length
+   * so that decoding garbage still makes progress, but no more than the
+   * shortest code, which the decoders always have buffered. */
+  for (int slot = 0; slot < (1 << LOOKUP_BITS); slot++) {
+    table->entries[slot].symbol = 0;
+    table->entries[slot].length = 1;
+  }
+  int lengthCount[MAX_CODE_LENGTH + 1] = {0};
+  table->maxLength = 0;
+  for (int symbol = 0; symbol < ALPHABET_SIZE; symbol++) {
+    int length = codes->length[symbol];
+    lengthCount[length]++;
+    table->maxLength = length > table->maxLength ? length : table->maxLength;
+    if (length == 0) {
+      continue;
+    }
+    uint32_t code = codes->code[symbol];
+    if (length <= LOOKUP_BITS) {
+      /* Every slot that starts with this code decodes to the symbol */
+      int first = code << (LOOKUP_BITS - length);
+      int last = first + (1 << (LOOKUP_BITS - length));
+      for (int slot = first; slot < last; slot++) {
+        table->entries[slot].symbol = (uint8_t)symbol;
+        table->entries[slot].length = (uint8_t)length;
+      }
+    } else {
+      table->entries[code >> (length - LOOKUP_BITS)].length = 0;
+    }
+  }
+  /* Canonical ranges: codes of one length are consecutive, in symbol order */
+  uint32_t code = 0;
+  int offset = 0;
+  lengthCount[0] = 0;
+  for (int length = 1; length <= MAX_CODE_LENGTH; length++) {
+    code = (code + lengthCount[length - 1]) << 1;
+    table->firstCode[length] = code;
+    table->offset[length] = (uint16_t)offset;
+    table->limit[length] = ((uint64_t)code + lengthCount[length])
+                           << (MAX_CODE_LENGTH - length);
+    offset += lengthCount[length];
+  }
+  /* Sentinel so the long code search always stops */
+  table->limit[MAX_CODE_LENGTH + 1] = UINT64_MAX;
+  uint16_t next[MAX_CODE_LENGTH + 1];
+  memcpy(next, table->offset, sizeof(next));
+  for (int symbol = 0; symbol < ALPHABET_SIZE; symbol++) {
+    if (codes->length[symbol] != 0) {
+      table->sorted[next[codes->length[symbol]]++] = (uint8_t)symbol;
+    }
+  }
+}
+
+/**
+Decodes a code longer than LOOKUP_BITS from its canonical range
+@param table is the decode table for the stream
+@param reader holds at least MAX_CODE_LENGTH buffered bits
+@return the decoded symbol
+*/
+static uint8_t decodeLongCode(const decodeTable *table, bitReader *reader) {
+  uint32_t bits = peekBits(reader, MAX_CODE_LENGTH);
+  int length = LOOKUP_BITS + 1;
+  while (bits >= table->limit[length]) {
+    length++;
+  }
+  if (length > table->maxLength) {
+    /* Corrupt stream */
+    skipBits(reader, LOOKUP_BITS);
+    return 0;
+  }
+  skipBits(reader, length);
+  uint32_t index = (bits >> (MAX_CODE_LENGTH - length)) -
+                   table->firstCode[length] + table->offset[length];
+  return table->sorted[index];
+}
+
+/**
+Decodes one symbol
+@param table is the decode table for the stream
+@param reader holds at least table->maxLength buffered bits
+@return the decoded symbol
+*/
+static inline uint8_t decodeOne(const decodeTable *table, bitReader *reader) {
+  decodeEntry entry = table->entries[peekBits(reader, LOOKUP_BITS)];
+  if (entry.length != 0) {
+    skipBits(reader, entry.length);
+    return entry.symbol;
+  }
+  return decodeLongCode(table, reader);
+}
+
+/**
+Decodes symbols from a bit reader that may already be part way through a
+stream
+@param table is the decode table for the stream
+@param reader is the bit reader to decode from
+@param out receives the decoded symbols
+@param count is the number of symbols to decode
+*/
+static void decodeFromReader(const decodeTable *table, bitReader *reader,
+                             uint8_t *out, size_t count) {
+  uint8_t *end = out + count;
+  int maxLength = table->maxLength > 0 ? table->maxLength : 1;
+  while (out < end) {
+    refillBits(reader);
+    /* A refill leaves at least 56 bits, so keep decoding while a code of any
+     * length is guaranteed to be buffered */
+    do {
+      *out++ = decodeOne(table, reader);
+    } while (reader->count >= maxLength && out < end);
+  }
+}
+
+/**
+Decodes a fixed number of symbols
+@param table is the decode table for the stream
+@param in is the huffman coded stream
+@param inSize is the number of bytes in the stream
+@param out receives the decoded symbols
+@param count is the number of symbols to decode
+*/
+void decodeSymbols(const decodeTable *table, const uint8_t *in, size_t inSize,
+                   uint8_t *out, size_t count) {
+  bitReader reader;
+  bitReaderInit(&reader, in, inSize);
+  decodeFromReader(table, &reader, out, count);
+}
+
+/**
+Decodes four streams in lockstep. The four bit readers are independent, so the
+table probes of different streams overlap instead of waiting on each other.
+@param table is the decode table shared by the streams
+@param streams is the start of each stream
+@param sizes is the number of bytes in each stream
+@param out receives the decoded symbols of all streams, in order
+@param count is the total number of symbols
+*/
+static void decodeFourStreams(const decodeTable *table,
+                              const uint8_t *const *streams,
+                              const size_t *sizes, uint8_t *out,
+                              size_t count) {
+  bitReader r0, r1, r2, r3;
+  bitReaderInit(&r0, streams[0], sizes[0]);
+  bitReaderInit(&r1, streams[1], sizes[1]);
+  bitReaderInit(&r2, streams[2], sizes[2]);
+  bitReaderInit(&r3, streams[3], sizes[3]);
+  uint8_t *o0 = out + streamStart(count, 4, 0);
+  uint8_t *o1 = out + streamStart(count, 4, 1);
+  uint8_t *o2 = out + streamStart(count, 4, 2);
+  uint8_t *o3 = out + streamStart(count, 4, 3);
+  /* The last stream is the shortest */
+  size_t common = count - streamStart(count, 4, 3);
+  int maxLength = table->maxLength > 0 ? table->maxLength : 1;
+  int perRefill = 56 / maxLength > 4 ? 4 : 56 / maxLength;
+  size_t i = 0;
+  for (; i + perRefill <= common; i += perRefill) {
+    refillBits(&r0);
+    refillBits(&r1);
+    refillBits(&r2);
+    refillBits(&r3);
+    for (int j = 0; j < perRefill; j++) {
+      o0[i + j] = decodeOne(table, &r0);
+      o1[i + j] = decodeOne(table, &r1);
+      o2[i + j] = decodeOne(table, &r2);
+      o3[i + j] = decodeOne(table, &r3);
+    }
+  }
+  decodeFromReader(table, &r0, o0 + i, o1 - o0 - i);
+  decodeFromReader(table, &r1, o1 + i, o2 - o1 - i);
+  decodeFromReader(table, &r2, o2 + i, o3 - o2 - i);
+  decodeFromReader(table, &r3, o3 + i, out + count - o3 - i);
+}
+
+/**
+Decodes a block that was split into interleaved streams
+@param table is the decode table shared by the streams
+@param streams is the start of each stream
+@param sizes is the number of bytes in each stream
+@param streamCount is the number of streams, at most MAX_STREAMS
+@param out receives the decoded symbols of all streams, in order
+@param count is the total number of symbols
+*/
+void decodeStreams(const decodeTable *table, const uint8_t *const *streams,
+                   const size_t *sizes, int streamCount, uint8_t *out,
+                   size_t count) {
+  if (streamCount == 4) {
+    decodeFourStreams(table, streams, sizes, out, count);
+    return;
+  }
+  for (int k = 0; k < streamCount; k++) {
+    size_t start = streamStart(count, streamCount, k);
+    size_t end = streamStart(count, streamCount, k + 1);
+    decodeSymbols(table, streams[k], sizes[k], out + start, end - start);
+  }
+}
+
+/**
+Fills a multi symbol decode table. Each slot is decoded greedily with the
+single symbol table until the next code no longer ends inside the slot.
+@param codes is the canonical code table the data was encoded with
+@param table is the decode table to fill
+*/
+void buildMultiDecodeTable(const codeTable *codes, multiDecodeTable *table) {
+  buildDecodeTable(codes, &table->single);
+  table->slotSymbols = 0;
+  const int mask = (1 << LOOKUP_BITS) - 1;
+  for (int slot = 0; slot <= mask; slot++) {
+    multiEntry *entry = &table->entries[slot];
+    memset(entry, 0, sizeof(*entry));
+    int used = 0;
+    while (entry->count < MULTI_SYMBOLS) {
+      /* The bits shifted in past the slot are unknown, so a code only counts
+       * if it ends inside the slot */
+      decodeEntry next = table->single.entries[(slot << used) & mask];
+      if (next.length == 0 || used + next.length > LOOKUP_BITS) {
+        break;
+      }
+      entry->symbols[entry->count++] = next.symbol;
+      used += next.length;
+    }
+    entry->length = (uint8_t)used;
+    table->slotSymbols += entry->count;
+  }
+}
+
+/**
+Decodes the codes in the next LOOKUP_BITS bits, or one long code. All
+MULTI_SYMBOLS symbols of the slot are stored, but only the valid ones are
+stepped over, so the next probe overwrites the rest.
+@param table is the multi symbol decode table for the stream
+@param reader holds at least LOOKUP_BITS and table->single.maxLength buffered
+bits
+@param out receives the symbols, with room for MULTI_SYMBOLS
+@return the position after the decoded symbols
+*/
+static inline uint8_t *decodeMulti(const multiDecodeTable *table,
+                                   bitReader *reader, uint8_t *out) {
+  const multiEntry *entry = &table->entries[peekBits(reader, LOOKUP_BITS)];
+  if (entry->count != 0) {
+    skipBits(reader, entry->length);
+    memcpy(out, entry->symbols, MULTI_SYMBOLS);
+    return out + entry->count;
+  }
+  *out = decodeLongCode(&table->single, reader);
+  return out + 1;
+}
+
+/**
+Buffered bits a multi symbol probe needs
+@param table is the multi symbol decode table
+@return the larger of LOOKUP_BITS and the longest code length
+*/
+static inline int multiBits(const multiDecodeTable *table) {
+  return table->single.maxLength > LOOKUP_BITS ? table->single.maxLength
+                                               : LOOKUP_BITS;
+}
+
+/**
+Decodes symbols with a multi symbol table from a bit reader that may already be
+part way through a stream. The last few symbols, which a slot could overrun,
+are decoded one at a time.
+@param table is the multi symbol decode table for the stream
+@param reader is the bit reader to decode from
+@param out receives the decoded symbols
+@param count is the number of symbols to decode
+*/
+static void decodeMultiFromReader(const multiDecodeTable *table,
+                                  bitReader *reader, uint8_t *out,
+                                  size_t count) {
+  uint8_t *end = out + count;
+  int bits = multiBits(table);
+  while (end - out >= MULTI_SYMBOLS) {
+    refillBits(reader);
+    do {
+      out = decodeMulti(table, reader, out);
+    } while (reader->count >= bits && end - out >= MULTI_SYMBOLS);
+  }
+  decodeFromReader(&table->single, reader, out, end - out);
+}
+
+/**
+Decodes a fixed number of symbols with a multi symbol table
+@param table is the decode table for the stream
+@param in is the huffman coded stream
+@param inSize is the number of bytes in the stream
+@param out receives the decoded symbols
+@param count is the number of symbols to decode
+*/
+void decodeMultiSymbols(const multiDecodeTable *table, const uint8_t *in,
+                        size_t inSize, uint8_t *out, size_t count) {
+  if (table->slotSymbols < MULTI_MIN_SLOT_SYMBOLS) {
+    decodeSymbols(&table->single, in, inSize, out, count);
+    return;
+  }
+  bitReader reader;
+  bitReaderInit(&reader, in, inSize);
+  decodeMultiFromReader(table, &reader, out, count);
+}
+
+/**
+Decodes four streams in lockstep with a multi symbol table. The streams emit
+symbols at different rates, so the lockstep runs while every stream has room
+for a full round.
+@param table is the decode table shared by the streams
+@param streams is the start of each stream
+@param sizes is the number of bytes in each stream
+@param out receives the decoded symbols of all streams, in order
+@param count is the total number of symbols
+*/
+static void decodeMultiFourStreams(const multiDecodeTable *table,
+                                   const uint8_t *const *streams,
+                                   const size_t *sizes, uint8_t *out,
+                                   size_t count) {
+  bitReader r0, r1, r2, r3;
+  bitReaderInit(&r0, streams[0], sizes[0]);
+  bitReaderInit(&r1, streams[1], sizes[1]);
+  bitReaderInit(&r2, streams[2], sizes[2]);
+  bitReaderInit(&r3, streams[3], sizes[3]);
+  uint8_t *o0 = out + streamStart(count, 4, 0);
+  uint8_t *o1 = out + streamStart(count, 4, 1);
+  uint8_t *o2 = out + streamStart(count, 4, 2);
+  uint8_t *o3 = out + streamStart(count, 4, 3);
+  uint8_t *e0 = o1, *e1 = o2, *e2 = o3, *e3 = out + count;
+  int perRefill = 56 / multiBits(table);
+  ptrdiff_t round = (ptrdiff_t)perRefill * MULTI_SYMBOLS;
+  while (e0 - o0 >= round && e1 - o1 >= round && e2 - o2 >= round &&
+         e3 - o3 >= round) {
+    refillBits(&r0);
+    refillBits(&r1);
+    refillBits(&r2);
+    refillBits(&r3);
+    for (int j = 0; j < perRefill; j++) {
+      o0 = decodeMulti(table, &r0, o0);
+      o1 = decodeMulti(table, &r1, o1);
+      o2 = decodeMulti(table, &r2, o2);
+      o3 = decodeMulti(table, &r3, o3);
+    }
+  }
+  decodeMultiFromReader(table, &r0, o0, e0 - o0);
+  decodeMultiFromReader(table, &r1, o1, e1 - o1);
+  decodeMultiFromReader(table, &r2, o2, e2 - o2);
+  decodeMultiFromReader(table, &r3, o3, e3 - o3);
+}
+
+/**
+Decodes a block that was split into interleaved streams with a multi symbol
+table
+@param table is the decode table shared by the streams
+@param streams is the start of each stream
+@param sizes is the number of bytes in each stream
+@param streamCount is the number of streams, at most MAX_STREAMS
+@param out receives the decoded symbols of all streams, in order
+@param count is the total number of symbols
+*/
+void decodeMultiStreams(const multiDecodeTable *table,
+                        const uint8_t *const *streams, const size_t *sizes,
+                        int streamCount, uint8_t *out, size_t count) {
+  if (table->slotSymbols < MULTI_MIN_SLOT_SYMBOLS) {
+    decodeStreams(&table->single, streams, sizes, streamCount, out, count);
+    return;
+  }
+  if (streamCount == 4) {
+    decodeMultiFourStreams(table, streams, sizes, out, count);
+    return;
+  }
+  for (int k = 0; k < streamCount; k++) {
+    size_t start = streamStart(count, streamCount, k);
+    size_t end = streamStart(count, streamCount, k + 1);
+    decodeMultiSymbols(table, streams[k], sizes[k], out + start, end - start);
+  }
+}
+
+/**
+Decodes symbols that were each coded with the table of the symbol before
+them. The first symbol is decoded as if it followed a 0.
+@param tables is the decode table for each preceding symbol
+@param in is the huffman coded stream
+@param inSize is the number of bytes in the stream
+@param out receives the decoded symbols
+@param count is the number of symbols to decode
+*/
+void decodeContextSymbols(const decodeTable *const *tables, const uint8_t *in,
+                          size_t inSize, uint8_t *out, size_t count) {
+  bitReader reader;
+  bitReaderInit(&reader, in, inSize);
+  int maxLength = 1;
+  for (int context = 0; context < ALPHABET_SIZE; context++) {
+    if (tables[context]->maxLength > maxLength) {
+      maxLength = tables[context]->maxLength;
+    }
+  }
+  uint8_t *end = out + count;
+  uint8_t previous = 0;
+  while (out < end) {
+    refillBits(&reader);
+    do {
+      previous = decodeOne(tables[previous], &reader);
+      *out++ = previous;
+    } while (reader.count >= maxLength && out < end);
+  }
+}
+
+/**
+One block frame for a worker thread
+*/
+typedef struct FrameJob {
+  int type;             /**< Block type */
+  const uint8_t *table; /**< Frame holding the repeated table, or NULL */
+  size_t tableSize;     /**< Number of bytes in table */
+  const uint8_t *in;    /**< Frame after the block header */
+  size_t inSize;        /**< Number of bytes in the frame after the header */
+  uint8_t *out;         /**< Where the original block goes */
+  size_t outSize;       /**< Number of bytes in the original block */
+  int status;           /**< Result of decodeBlock() */
+} frameJob;
+
+/**
+Fills decoder options with the defaults
+@param options is the options to reset
+*/
+void defaultDecoderOptions(decoderOptions *options) {
+  options->threads = processorCount();
+}
+
+/**
+Worker task: decompresses the frame of a job
+@param argument is the frameJob
+*/
+static void runFrameJob(void *argument) {
+  frameJob *job = argument;
+  uint64_t start = startPhase();
+  job->status = decodeBlock(job->type, job->table, job->tableSize, job->in,
+                            job->inSize, job->out, job->outSize);
+  endPhase(PHASE_DECODE, start);
+  countStat(COUNTER_BLOCKS, 1);
+}
+
+/**
+The header and block index of a compressed file
+*/
+typedef struct Container {
+  uint64_t originalSize; /**< Number of bytes in the original file */
+  size_t blockSize;      /**< Number of original bytes per block */
+  size_t blockCount;     /**< Number of block frames */
+  const uint8_t *index;  /**< First block index entry */
+} container;
+
+/**
+Reads the header and locates the block index of a compressed file. Every
+block must have a frame of its own, in order, so the original size is bounded
+by the frames the file has room for before anything is allocated for it.
+@param in is the compressed file
+@param inSize is the number of bytes in the file
+@param file receives the header fields and the index
+@return 0 on success, -1 if the file is not a compressed file or is corrupt
+*/
+static int openContainer(const uint8_t *in, size_t inSize, container *file) {
+  if (inSize < HEADER_SIZE + FOOTER_SIZE || !checkMagic(in, MAGIC_FILE)) {
+    return -1;
+  }
+  file->originalSize = load64(in + 4);
+  file->blockSize = load32(in + 12);
+  /* A block of one byte value takes a few bytes however long it is, so the
+   * size is only bounded through the number of frames. Each block needs a
+   * frame of its own of at least a header and one byte, in order. */
+  if (file->blockSize == 0 || file->blockSize > MAX_BLOCK_SIZE ||
+      file->originalSize / file->blockSize > inSize / MIN_FRAME_SIZE) {
+    return -1;
+  }
+  file->blockCount =
+      (file->originalSize + file->blockSize - 1) / file->blockSize;
+  uint64_t indexOffset = load64(in + inSize - FOOTER_SIZE);
+  if (indexOffset < HEADER_SIZE || indexOffset > inSize ||
+      indexOffset + (uint64_t)file->blockCount * INDEX_ENTRY_SIZE !=
+          inSize - FOOTER_SIZE ||
+      file->blockCount > (indexOffset - HEADER_SIZE) / MIN_FRAME_SIZE) {
+    return -1;
+  }
+  file->index = in + indexOffset;
+  uint64_t previous = HEADER_SIZE;
+  for (size_t block = 0; block < file->blockCount; block++) {
+    uint64_t offset = load64(file->index + block * INDEX_ENTRY_SIZE);
+    if (offset < previous || offset > indexOffset - MIN_FRAME_SIZE) {
+      return -1;
+    }
+    previous = offset + MIN_FRAME_SIZE;
+  }
+  return 0;
+}
+
+/**
+Finds the frame of a block through the block index
+@param in is the compressed file
+@param file is the header and index of the file
+@param block is the block to find
+@param frameSize receives the number of bytes in the frame after the block
+header
+@return the frame, or NULL if the index entry does not point at a frame
+*/
+static const uint8_t *findFrame(const uint8_t *in, const container *file,
+                                size_t block, size_t *frameSize) {
+  size_t framesEnd = (size_t)(file->index - in);
+  uint64_t offset = load64(file->index + block * INDEX_ENTRY_SIZE);
+  if (offset < HEADER_SIZE || offset > framesEnd ||
+      framesEnd - offset < BLOCK_HEADER_SIZE) {
+    return NULL;
+  }
+  *frameSize = load32(in + offset + 1);
+  if (framesEnd - offset - BLOCK_HEADER_SIZE < *frameSize) {
+    return NULL;
+  }
+  return in + offset;
+}
+
+/**
+Finds the frames of a run of blocks through the block index, along with the
+frames that hold the tables of those that repeat one
+@param in is the compressed file
+@param file is the header and index of the file
+@param first is the first block to find
+@param count is the number of blocks to find
+@param jobs receives one job per block
+@param output is the buffer for the original data of the blocks
+@return 0 on success, -1 if an index entry does not point at a frame
+*/
+static int findFrames(const uint8_t *in, const container *file, size_t first,
+                      size_t count, frameJob *jobs, uint8_t *output) {
+  for (size_t i = 0; i < count; i++) {
+    size_t block = first + i;
+    size_t frameSize, tableSize = 0;
+    const uint8_t *frame = findFrame(in, file, block, &frameSize);
+    if (frame == NULL) {
+      return -1;
+    }
+    /* A frame that repeats a table names an earlier frame that has one */
+    const uint8_t *table = NULL;
+    size_t tableBlock = load32(file->index + block * INDEX_ENTRY_SIZE + 8);
+    int repeat = (frame[0] & BLOCK_REPEAT_TABLE) != 0;
+    if (repeat != (tableBlock != block) || tableBlock > block) {
+      return -1;
+    }
+    if (repeat) {
+      table = findFrame(in, file, tableBlock, &tableSize);
+      if (table == NULL ||
+          (table[0] != BLOCK_HUFFMAN && table[0] != BLOCK_STREAMS)) {
+        return -1;
+      }
+      table += BLOCK_HEADER_SIZE;
+    }
+    jobs[i].type = frame[0];
+    jobs[i].table = table;
+    jobs[i].tableSize = tableSize;
+    jobs[i].in = frame + BLOCK_HEADER_SIZE;
+    jobs[i].inSize = frameSize;
+    jobs[i].out = output + i * file->blockSize;
+    jobs[i].outSize = block + 1 < file->blockCount
+                          ? file->blockSize
+                          : file->originalSize - block * file->blockSize;
+  }
+  return 0;
+}
+
+/**
+Decompresses a run of frames, in parallel when there is more than one and a
+pool of workers can be started, on this thread otherwise
+@param jobs is the frames to decompress
+@param count is the number of frames
+@param threads is the number of worker threads to use
+@return index of the first corrupt frame, or -1 if every frame decoded
+*/
+static long runFrameJobs(frameJob *jobs, size_t count, int threads) {
+  threadPool *pool =
+      threads > 1 && count > 1 ? createThreadPool(threads) : NULL;
+  for (size_t i = 0; i < count; i++) {
+    if (pool != NULL) {
+      submitTask(pool, runFrameJob, &jobs[i]);
+    } else {
+      runFrameJob(&jobs[i]);
+    }
+  }
+  if (pool != NULL) {
+    destroyThreadPool(pool);
+  }
+  for (size_t i = 0; i < count; i++) {
+    if (jobs[i].status < 0) {
+      return (long)i;
+    }
+  }
+  return -1;
+}
+
+/**
+Reports a frame that failed to decode
+@param job is the frame
+@param inPath is the compressed file
+@param block is the block of the frame
+*/
+static void reportFrameJob(const frameJob *job, const char *inPath,
+                           size_t block) {
+  if (job->status == BLOCK_NO_MEMORY) {
+    fprintf(stderr, "%s: out of memory decoding block %zu\n", inPath, block);
+  } else {
+    fprintf(stderr, "%s: corrupt block %zu\n", inPath, block);
+  }
+}
+
+/**
+Writes a buffer to a new file
+@param path is the file to write
+@param data is the bytes to write
+@param size is the number of bytes
+@return 0 on success, -1 on failure with a message printed to stderr
+*/
+static int writeOutput(const char *path, const uint8_t *data, size_t size) {
+  uint64_t start = startPhase();
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    perror(path);
+    return -1;
+  }
+  size_t written = fwrite(data, 1, size, file);
+  int closed = fclose(file);
+  endPhase(PHASE_WRITE, start);
+  if (closed != 0 || written != size) {
+    perror(path);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+Decompresses a file
+@param inPath is the compressed file, or "-" for standard input
+@param outPath is the file to write the original data to
+@param options are the decoder settings, or NULL for the defaults
+@param result receives the sizes and time taken, may be NULL
+@return 0 on success, -1 on failure with a message printed to stderr
+*/
+int decompressFile(const char *inPath, const char *outPath,
+                   const decoderOptions *options, codingResult *result) {
+  double start = now();
+  decoderOptions defaults;
+  if (options == NULL) {
+    defaultDecoderOptions(&defaults);
+    options = &defaults;
+  }
+  inputSource input;
+  if (openInput(inPath, &input) < 0) {
+    return -1;
+  }
+  int status = -1;
+  uint8_t *out = NULL;
+  frameJob *jobs = NULL;
+  container file;
+  if (openContainer(input.data, input.size, &file) < 0) {
+    fprintf(stderr, "%s: not a compressed file\n", inPath);
+    goto done;
+  }
+  out = malloc(file.originalSize > 0 ? file.originalSize : 1);
+  jobs =
+      malloc(sizeof(frameJob) * (file.blockCount > 0 ? file.blockCount : 1));
+  if (out == NULL || jobs == NULL) {
+    fprintf(stderr, "%s: not enough memory for the %" PRIu64 " byte original\n",
+            inPath, file.originalSize);
+    goto done;
+  }
+  if (findFrames(input.data, &file, 0, file.blockCount, jobs, out) < 0) {
+    fprintf(stderr, "%s: corrupt block index\n", inPath);
+    goto done;
+  }
+  long corrupt = runFrameJobs(jobs, file.blockCount, options->threads);
+  if (corrupt >= 0) {
+    reportFrameJob(&jobs[corrupt], inPath, corrupt);
+    goto done;
+  }
+  if (writeOutput(outPath, out, file.originalSize) < 0) {
+    goto done;
+  }
+  status = 0;
+  countStat(COUNTER_BYTES_IN, input.size);
+  countStat(COUNTER_BYTES_OUT, file.originalSize);
+  if (result != NULL) {
+    result->inputBytes = input.size;
+    result->outputBytes = file.originalSize;
+    result->payloadBits = 0;
+    result->optimalBits = 0;
+  }
+
+done:
+  closeInput(&input);
+  free(out);
+  free(jobs);
+  if (result != NULL) {
+    result->seconds = now() - start;
+  }
+  return status;
+}
+
+/**
+Decompresses a byte range of a file. Only the blocks that cover the range are
+decoded, and with a memory mapped input only their frames are read.
+@param inPath is the compressed file, or "-" for standard input
+@param outPath is the file to write the requested bytes to
+@param offset is the first original byte to extract
+@param length is the number of original bytes to extract
+@param options are the decoder settings, or NULL for the defaults
+@param result receives the compressed bytes used, the bytes extracted and the
+time taken, may be NULL
+@return 0 on success, -1 on failure with a message printed to stderr
+*/
+int decompressRange(const char *inPath, const char *outPath, uint64_t offset,
+                    uint64_t length, const decoderOptions *options,
+                    codingResult *result) {
+  double start = now();
+  decoderOptions defaults;
+  if (options == NULL) {
+    defaultDecoderOptions(&defaults);
+    options = &defaults;
+  }
+  inputSource input;
+  if (openInput(inPath, &input) < 0) {
+    return -1;
+  }
+  int status = -1;
+  uint8_t *out = NULL;
+  frameJob *jobs = NULL;
+  container file;
+  if (openContainer(input.data, input.size, &file) < 0) {
+    fprintf(stderr, "%s: not a compressed file\n", inPath);
+    goto done;
+  }
+  if (offset > file.originalSize || length > file.originalSize - offset) {
+    fprintf(stderr, "%s: range is past the end of the %" PRIu64 " byte "
+            "original\n", inPath, file.originalSize);
+    goto done;
+  }
+  size_t first = offset / file.blockSize;
+  size_t count = length > 0 ? (offset + length - 1) / file.blockSize + 1 - first
+                            : 0;
+  out = malloc(count > 0 ? count * file.blockSize : 1);
+  jobs = malloc(sizeof(frameJob) * (count > 0 ? count : 1));
+  if (out == NULL || jobs == NULL) {
+    fprintf(stderr, "%s: not enough memory for %zu blocks\n", inPath, count);
+    goto done;
+  }
+  if (findFrames(input.data, &file, first, count, jobs, out) < 0) {
+    fprintf(stderr, "%s: corrupt block index\n", inPath);
+    goto done;
+  }
+  long corrupt = runFrameJobs(jobs, count, options->threads);
+  if (corrupt >= 0) {
+    reportFrameJob(&jobs[corrupt], inPath, first + corrupt);
+    goto done;
+  }
+  if (writeOutput(outPath, out + (offset - first * file.blockSize), length) <
+      0) {
+    goto done;
+  }
+  status = 0;
+  /* Only the header, the frames of the range and their index entries were
+   * needed */
+  uint64_t inputBytes = HEADER_SIZE + count * INDEX_ENTRY_SIZE + FOOTER_SIZE;
+  for (size_t i = 0; i < count; i++) {
+    inputBytes += BLOCK_HEADER_SIZE + jobs[i].inSize;
+  }
+  countStat(COUNTER_BYTES_IN, inputBytes);
+  countStat(COUNTER_BYTES_OUT, length);
+  if (result != NULL) {
+    result->inputBytes = inputBytes;
+    result->outputBytes = length;
+    result->payloadBits = 0;
+    result->optimalBits = 0;
+  }
+
+done:
+  closeInput(&input);
+  free(out);
+  free(jobs);
+  if (result != NULL) {
+    result->seconds = now() - start;
+  }
+  return status;
+}
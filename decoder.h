@@ -0,0 +1,201 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file contains the interface for decompressing files written by
+        compressFile(). Symbols are decoded with a lookup table indexed by
+        the next LOOKUP_BITS bits of the stream, so most symbols take a
+        single probe instead of one tree step per bit. Longer codes are
+        resolved from the canonical code ranges, so no tree is ever built.
+        Large blocks use a multi symbol table instead, whose slots hold every
+        whole code in the LOOKUP_BITS window, so one probe emits up to
+        MULTI_SYMBOLS symbols.
+
+*/
+
+#ifndef _DECODER_H_
+#define _DECODER_H_
+
+#include "encoder.h"
+#include "format.h"
+#include "huffman.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/** Number of bits used to index the decode table */
+#define LOOKUP_BITS 11
+
+/**
+One decode table slot. A length of 0 marks the prefix of a code longer than
+LOOKUP_BITS.
+*/
+typedef struct DecodeEntry {
+  uint8_t symbol; /**< Decoded symbol */
+  uint8_t length; /**< Bits to consume, or 0 for a long code */
+} decodeEntry;
+
+/**
+Lookup table for a canonical code table. Long codes are found by comparing the
+next 32 bits against limit[], the first left aligned code past each length.
+*/
+typedef struct DecodeTable {
+  decodeEntry entries[1 << LOOKUP_BITS]; /**< Slot per LOOKUP_BITS prefix */
+  uint64_t limit[MAX_CODE_LENGTH + 2]; /**< End of each length's code range */
+  uint32_t firstCode[MAX_CODE_LENGTH + 1]; /**< First code of each length */
+  uint16_t offset[MAX_CODE_LENGTH + 1]; /**< Index of that code in sorted */
+  uint8_t sorted[ALPHABET_SIZE];        /**< Symbols in canonical order */
+  int maxLength;                        /**< Longest code length */
+} decodeTable;
+
+/** Most symbols one multi symbol table slot decodes to */
+#define MULTI_SYMBOLS 4
+/** Fewest symbols in a block before a multi symbol table pays for building */
+#define MULTI_MIN_SYMBOLS (1 << 14)
+/** Fewest symbols summed over all slots for multi symbol probes to win, an
+ * average of 1.5 per slot. Every slot is equally likely under the code's own
+ * statistics, so the average is the expected number of symbols per probe. */
+#define MULTI_MIN_SLOT_SYMBOLS (3 << (LOOKUP_BITS - 1))
+
+/**
+One multi symbol table slot: the codes that fit whole in its LOOKUP_BITS
+prefix, decoded in order. A count of 0 marks the prefix of a code longer than
+LOOKUP_BITS.
+*/
+typedef struct MultiEntry {
+  uint8_t symbols[MULTI_SYMBOLS]; /**< Decoded symbols, count of them valid */
+  uint8_t count;                  /**< Symbols in the slot, 0 for a long code */
+  uint8_t length;                 /**< Bits the symbols take together */
+  uint8_t padding[2];             /**< Makes a slot 8 bytes */
+} multiEntry;
+
+/**
+Lookup table that decodes several short codes per probe. Long codes fall back
+to the canonical ranges of the single symbol table it was built from, and so
+does all decoding when the slots average too few symbols to gain anything.
+*/
+typedef struct MultiDecodeTable {
+  multiEntry entries[1 << LOOKUP_BITS]; /**< Slot per LOOKUP_BITS prefix */
+  decodeTable single;                   /**< Table for long codes and tails */
+  int slotSymbols;                      /**< Sum of count over all slots */
+} multiDecodeTable;
+
+/**
+Fills a decode table
+@param codes is the canonical code table the data was encoded with
+@param table is the decode table to fill
+*/
+void buildDecodeTable(const codeTable *codes, decodeTable *table);
+
+/**
+Fills a multi symbol decode table. Building one costs a few thousand probes of
+the single symbol table, so it only pays off for at least MULTI_MIN_SYMBOLS
+symbols, or for a table that is reused.
+@param codes is the canonical code table the data was encoded with
+@param table is the decode table to fill
+*/
+void buildMultiDecodeTable(const codeTable *codes, multiDecodeTable *table);
+
+/**
+Decodes a fixed number of symbols
+@param table is the decode table for the stream
+@param in is the huffman coded stream
+@param inSize is the number of bytes in the stream
+@param out receives the decoded symbols
+@param count is the number of symbols to decode
+*/
+void decodeSymbols(const decodeTable *table, const uint8_t *in, size_t inSize,
+                   uint8_t *out, size_t count);
+
+/**
+Decodes a fixed number of symbols with a multi symbol table
+@param table is the decode table for the stream
+@param in is the huffman coded stream
+@param inSize is the number of bytes in the stream
+@param out receives the decoded symbols
+@param count is the number of symbols to decode
+*/
+void decodeMultiSymbols(const multiDecodeTable *table, const uint8_t *in,
+                        size_t inSize, uint8_t *out, size_t count);
+
+/**
+Decodes a block that was split into interleaved streams
+@param table is the decode table shared by the streams
+@param streams is the start of each stream
+@param sizes is the number of bytes in each stream
+@param streamCount is the number of streams, at most MAX_STREAMS
+@param out receives the decoded symbols of all streams, in order
+@param count is the total number of symbols
+*/
+void decodeStreams(const decodeTable *table, const uint8_t *const *streams,
+                   const size_t *sizes, int streamCount, uint8_t *out,
+                   size_t count);
+
+/**
+Decodes a block that was split into interleaved streams with a multi symbol
+table
+@param table is the decode table shared by the streams
+@param streams is the start of each stream
+@param sizes is the number of bytes in each stream
+@param streamCount is the number of streams, at most MAX_STREAMS
+@param out receives the decoded symbols of all streams, in order
+@param count is the total number of symbols
+*/
+void decodeMultiStreams(const multiDecodeTable *table,
+                        const uint8_t *const *streams, const size_t *sizes,
+                        int streamCount, uint8_t *out, size_t count);
+
+/**
+Decodes symbols that were each coded with the table of the symbol before
+them. The first symbol is decoded as if it followed a 0.
+@param tables is the decode table for each preceding symbol
+@param in is the huffman coded stream
+@param inSize is the number of bytes in the stream
+@param out receives the decoded symbols
+@param count is the number of symbols to decode
+*/
+void decodeContextSymbols(const decodeTable *const *tables, const uint8_t *in,
+                          size_t inSize, uint8_t *out, size_t count);
+
+/**
+Settings for decompressFile()
+*/
+typedef struct DecoderOptions {
+  int threads; /**< Worker threads decompressing blocks */
+} decoderOptions;
+
+/**
+Fills decoder options with the defaults
+@param options is the options to reset
+*/
+void defaultDecoderOptions(decoderOptions *options);
+
+/**
+Decompresses a file
+@param inPath is the compressed file, or "-" for standard input
+@param outPath is the file to write the original data to
+@param options are the decoder settings, or NULL for the defaults
+@param result receives the sizes and time taken, may be NULL
+@return 0 on success, -1 on failure with a message printed to stderr
+*/
+int decompressFile(const char *inPath, const char *outPath,
+                   const decoderOptions *options, codingResult *result);
+
+/**
+Decompresses a byte range of a file. Only the blocks that cover the range are
+decoded, and with a memory mapped input only their frames are read.
+@param inPath is the compressed file, or "-" for standard input
+@param outPath is the file to write the requested bytes to
+@param offset is the first original byte to extract
+@param length is the number of original bytes to extract
+@param options are the decoder settings, or NULL for the defaults
+@param result receives the compressed bytes used, the bytes extracted and the
+time taken, may be NULL
+@return 0 on success, -1 on failure with a message printed to stderr
+*/
+int decompressRange(const char *inPath, const char *outPath, uint64_t offset,
+                    uint64_t length, const decoderOptions *options,
+                    codingResult *result);
+
+#endif
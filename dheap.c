@@ -0,0 +1,224 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file implements the 4-ary heap. Sifts move a hole instead of
+        swapping, so every level costs one store, and neither sift
+        recurses. While the heap fits in the cache, mispredicted branches
+        cost more than memory, so the smallest child is picked without
+        branching.
+
+ */
+#include "dheap.h"
+#include "stats.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+Entry order: by weight, then by index, which is just the order of the keys
+@param a is the first entry
+@param b is the second entry
+@return true if a comes before b
+*/
+static inline bool lessThan(heapItem a, heapItem b) {
+  return a.key < b.key;
+}
+
+/**
+Position of the smallest of four consecutive entries. The two pairs are
+compared independently, so no comparison waits on a mispredicted branch.
+@param items is the heap entries
+@param first is the position of the first of the four
+@return position of the smallest one
+*/
+static inline int smallestOfFour(const heapItem *items, int first) {
+  int left = first + lessThan(items[first + 1], items[first]);
+  int right = first + 2 + lessThan(items[first + 3], items[first + 2]);
+  return lessThan(items[right], items[left]) ? right : left;
+}
+
+/**
+Moves an entry down until none of its children is smaller
+@param myHeap is the heap to fix
+@param i is the position of the entry
+*/
+static void siftDown(dHeap *myHeap, int i) {
+  heapItem *items = myHeap->items;
+  heapItem item = items[i];
+  int steps = 0;
+  for (;;) {
+    int first = HEAP_ARITY * i + 1;
+    if (first >= myHeap->size) {
+      break;
+    }
+    int best;
+    if (myHeap->size - first >= HEAP_ARITY) {
+      best = smallestOfFour(items, first);
+    } else {
+      best = first;
+      for (int child = first + 1; child < myHeap->size; child++) {
+        best = lessThan(items[child], items[best]) ? child : best;
+      }
+    }
+    if (!lessThan(items[best], item)) {
+      break;
+    }
+    items[i] = items[best];
+    i = best;
+    steps++;
+  }
+  items[i] = item;
+  countStat(COUNTER_HEAP_SIFTS, 1);
+  countStat(COUNTER_SIFT_STEPS, steps);
+}
+
+/**
+Moves an entry up until its parent is not larger
+@param myHeap is the heap to fix
+@param i is the position of the entry
+*/
+static void siftUp(dHeap *myHeap, int i) {
+  heapItem *items = myHeap->items;
+  heapItem item = items[i];
+  int steps = 0;
+  while (i > 0) {
+    int parent = (i - 1) / HEAP_ARITY;
+    if (!lessThan(item, items[parent])) {
+      break;
+    }
+    items[i] = items[parent];
+    i = parent;
+    steps++;
+  }
+  items[i] = item;
+  countStat(COUNTER_HEAP_SIFTS, 1);
+  countStat(COUNTER_SIFT_STEPS, steps);
+}
+
+/**
+Doubles the room for entries
+@param myHeap is the heap to grow
+@return 0 on success, -1 if out of memory
+*/
+static int growHeap(dHeap *myHeap) {
+  int capacity = myHeap->capacity > 0 ? myHeap->capacity * 2 : 16;
+  heapItem *items = malloc(sizeof(heapItem) * capacity);
+  if (items == NULL) {
+    return -1;
+  }
+  if (myHeap->size > 0) {
+    memcpy(items, myHeap->items, sizeof(heapItem) * myHeap->size);
+  }
+  if (myHeap->ownsItems) {
+    free(myHeap->items);
+  }
+  myHeap->items = items;
+  myHeap->capacity = capacity;
+  myHeap->ownsItems = true;
+  return 0;
+}
+
+/**
+Starts an empty heap
+@param myHeap is the heap to initialize
+@param storage is caller owned room for the first entries, may be NULL
+@param capacity is the number of entries storage holds
+*/
+void initDHeap(dHeap *myHeap, heapItem *storage, int capacity) {
+  myHeap->items = storage;
+  myHeap->size = 0;
+  myHeap->capacity = storage != NULL ? capacity : 0;
+  myHeap->ownsItems = false;
+}
+
+/**
+Frees the entries of a heap if they outgrew the caller's storage
+@param myHeap is the heap to free
+*/
+void freeDHeap(dHeap *myHeap) {
+  if (myHeap->ownsItems) {
+    free(myHeap->items);
+  }
+  myHeap->items = NULL;
+  myHeap->size = 0;
+  myHeap->capacity = 0;
+  myHeap->ownsItems = false;
+}
+
+/**
+Appends an entry without restoring heap order. Call heapify() once all the
+initial entries are added.
+@param myHeap is the heap to append to
+@param weight is the key of the entry, up to HEAP_MAX_WEIGHT
+@param index is the caller's handle for the entry, below 2^16
+@return 0 on success, -1 if the heap could not grow
+*/
+int addItem(dHeap *myHeap, uint64_t weight, uint32_t index) {
+  if (myHeap->size == myHeap->capacity && growHeap(myHeap) < 0) {
+    return -1;
+  }
+  myHeap->items[myHeap->size].key = weight << HEAP_INDEX_BITS | index;
+  myHeap->size++;
+  return 0;
+}
+
+/**
+Restores heap order over all entries in O(n)
+@param myHeap is the heap to order
+*/
+void heapify(dHeap *myHeap) {
+  if (myHeap->size < 2) {
+    return;
+  }
+  /* Leaves are already heaps; fix every parent from the last one up */
+  for (int i = (myHeap->size - 2) / HEAP_ARITY; i >= 0; i--) {
+    siftDown(myHeap, i);
+  }
+}
+
+/**
+Inserts an entry
+@param myHeap is the heap to insert into
+@param weight is the key of the entry, up to HEAP_MAX_WEIGHT
+@param index is the caller's handle for the entry, below 2^16
+@return 0 on success, -1 if the heap could not grow
+*/
+int pushItem(dHeap *myHeap, uint64_t weight, uint32_t index) {
+  if (addItem(myHeap, weight, index) < 0) {
+    return -1;
+  }
+  siftUp(myHeap, myHeap->size - 1);
+  return 0;
+}
+
+/**
+Removes the smallest entry
+@param myHeap is the heap to remove from, must not be empty
+@return the smallest entry
+*/
+heapItem popItem(dHeap *myHeap) {
+  heapItem top = myHeap->items[0];
+  myHeap->size--;
+  if (myHeap->size > 0) {
+    myHeap->items[0] = myHeap->items[myHeap->size];
+    siftDown(myHeap, 0);
+  }
+  return top;
+}
+
+/**
+Removes the smallest entry and inserts a new one with a single sift, which is
+cheaper than popItem() followed by pushItem()
+@param myHeap is the heap to update, must not be empty
+@param weight is the key of the new entry, up to HEAP_MAX_WEIGHT
+@param index is the caller's handle for the new entry, below 2^16
+@return the smallest entry before the update
+*/
+heapItem replaceTop(dHeap *myHeap, uint64_t weight, uint32_t index) {
+  heapItem top = myHeap->items[0];
+  myHeap->items[0].key = weight << HEAP_INDEX_BITS | index;
+  siftDown(myHeap, 0);
+  return top;
+}
@@ -0,0 +1,122 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file contains the interface for a 4-ary min heap of
+        (weight, index) pairs. The pairs are packed into one 64 bit key
+        stored inline, so a sift compares four adjacent keys in half a
+        cache line instead of following a pointer per comparison, and the
+        tree is half as deep as a binary heap.
+
+*/
+
+#ifndef _DHEAP_H_
+#define _DHEAP_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Number of children per heap entry */
+#define HEAP_ARITY 4
+/** Bits of a key that hold the index, which leaves 48 bits for the weight */
+#define HEAP_INDEX_BITS 16
+/** Largest weight a key holds. Nothing checks it, so callers whose weights
+ may grow past it must scale them down first. */
+#define HEAP_MAX_WEIGHT ((UINT64_C(1) << (64 - HEAP_INDEX_BITS)) - 1)
+
+/**
+One heap entry. The weight sits above the index in the key, so entries are
+ordered by weight and then by index, and equal weights always come out in the
+same order.
+*/
+typedef struct HeapItem {
+  uint64_t key; /**< Weight << HEAP_INDEX_BITS | index */
+} heapItem;
+
+/**
+4-ary min heap that grows when it runs out of room
+*/
+typedef struct DHeap {
+  heapItem *items; /**< Entries in heap order */
+  int size;        /**< Number of entries */
+  int capacity;    /**< Number of entries items can hold */
+  bool ownsItems;  /**< Whether items was malloc'd by the heap */
+} dHeap;
+
+/**
+Weight of a heap entry
+@param item is the entry
+@return the weight it was inserted with
+*/
+static inline uint64_t itemWeight(heapItem item) {
+  return item.key >> HEAP_INDEX_BITS;
+}
+
+/**
+Index of a heap entry
+@param item is the entry
+@return the index it was inserted with
+*/
+static inline int itemIndex(heapItem item) {
+  return (int)(item.key & ((1 << HEAP_INDEX_BITS) - 1));
+}
+
+/**
+Starts an empty heap
+@param myHeap is the heap to initialize
+@param storage is caller owned room for the first entries, may be NULL
+@param capacity is the number of entries storage holds
+*/
+void initDHeap(dHeap *myHeap, heapItem *storage, int capacity);
+
+/**
+Frees the entries of a heap if they outgrew the caller's storage
+@param myHeap is the heap to free
+*/
+void freeDHeap(dHeap *myHeap);
+
+/**
+Appends an entry without restoring heap order. Call heapify() once all the
+initial entries are added.
+@param myHeap is the heap to append to
+@param weight is the key of the entry, below 2^48
+@param index is the caller's handle for the entry, below 2^16
+@return 0 on success, -1 if the heap could not grow
+*/
+int addItem(dHeap *myHeap, uint64_t weight, uint32_t index);
+
+/**
+Restores heap order over all entries in O(n)
+@param myHeap is the heap to order
+*/
+void heapify(dHeap *myHeap);
+
+/**
+Inserts an entry
+@param myHeap is the heap to insert into
+@param weight is the key of the entry, below 2^48
+@param index is the caller's handle for the entry, below 2^16
+@return 0 on success, -1 if the heap could not grow
+*/
+int pushItem(dHeap *myHeap, uint64_t weight, uint32_t index);
+
+/**
+Removes the smallest entry
+@param myHeap is the heap to remove from, must not be empty
+@return the smallest entry
+*/
+heapItem popItem(dHeap *myHeap);
+
+/**
+Removes the smallest entry and inserts a new one with a single sift, which is
+cheaper than popItem() followed by pushItem()
+@param myHeap is the heap to update, must not be empty
+@param weight is the key of the new entry, below 2^48
+@param index is the caller's handle for the new entry, below 2^16
+@return the smallest entry before the update
+*/
+heapItem replaceTop(dHeap *myHeap, uint64_t weight, uint32_t index);
+
+#endif
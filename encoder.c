@@ -0,0 +1,528 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file implements the compressor. The memory mapped input is
+        split into blocks that are compressed on a pool of worker threads,
+        a batch at a time, and written out in order. Each block is scanned
+        twice: once to count symbol frequencies and once to stream every
+        symbol through the bit writer. Between the two scans the code
+        tables are chosen in block order, so a block can repeat the table
+        of the last frame that carried one. The offset of every frame and
+        the block holding its table are kept for the block index written
+        at the end.
+
+ */
+#include "encoder.h"
+#include "block.h"
+#include "bitio.h"
+#include "format.h"
+#include "histogram.h"
+#include "input.h"
+#include "stats.h"
+#include "threadpool.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/** Blocks compressed per worker before the batch is written out */
+#define BLOCKS_PER_THREAD 4
+/** Fewest symbols worth scanning the code table for the wide kernel */
+#define WIDE_MIN_SYMBOLS 64
+
+/**
+One block of work for a worker thread
+*/
+typedef struct BlockJob {
+  const uint8_t *in;             /**< Data of the block */
+  size_t size;                   /**< Number of bytes in the block */
+  const encoderOptions *options; /**< Encoder settings */
+  blockTable table;              /**< Histogram and chosen code table */
+  uint32_t tableBlock;           /**< Block whose frame holds the table */
+  encodedBlock block;            /**< Compressed frame */
+  int status;                    /**< Result of encodeBlock() */
+} blockJob;
+
+/**
+The jobs of one batch and the buffer their frames are coded into.
+compressFile() keeps two, so that one can be written out while the workers
+code the other.
+*/
+typedef struct Batch {
+  blockJob *jobs;  /**< Job of each block */
+  uint8_t *frames; /**< Frame slot of each job */
+  size_t first;    /**< Index of the first block of the batch */
+  int count;       /**< Number of blocks in the batch */
+} batch;
+
+/**
+The writer stage of compressFile(). Once a batch is queued, only the writer
+thread touches this until compressFile() waits for it.
+*/
+typedef struct WriteStage {
+  FILE *out;            /**< Output file */
+  const batch *next;    /**< Batch to write */
+  uint8_t *index;       /**< Block index, filled in as frames are written */
+  uint64_t outputBytes; /**< Bytes written so far */
+  uint64_t payloadBits; /**< Payload bits of the frames written */
+  uint64_t optimalBits; /**< Unlimited payload bits of the frames written */
+  int encodeStatus;     /**< Result of the first block that failed, or 0 */
+  int writeError;       /**< errno of the failed write, or 0 */
+} writeStage;
+
+/**
+Monotonic clock in seconds, used for throughput reports
+@return seconds since an arbitrary point in the past
+*/
+double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+Appends the codes of a run of symbols four at a time. Neighbouring codes are
+joined into pairs and the pairs into one word while their lengths are summed,
+so the bit writer sees one branch free wide write per four symbols. The rare
+four whose codes add up to more than 56 bits go out as their two pairs.
+@param table is the code table to encode with, with no code longer than 28
+bits
+@param in is the symbols to encode
+@param count is the number of symbols
+@param writer is the bit writer to append to, with fewer than 8 pending bits
+@return the number of symbols encoded, a multiple of 4
+*/
+static size_t encodeWide(const codeTable *table, const uint8_t *in,
+                         size_t count, bitWriter *writer) {
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    int length0 = table->length[in[i]];
+    int length1 = table->length[in[i + 1]];
+    int length2 = table->length[in[i + 2]];
+    int length3 = table->length[in[i + 3]];
+    uint64_t first =
+        (uint64_t)table->code[in[i]] << length1 | table->code[in[i + 1]];
+    uint64_t second =
+        (uint64_t)table->code[in[i + 2]] << length3 | table->code[in[i + 3]];
+    int firstLength = length0 + length1;
+    int secondLength = length2 + length3;
+    if (firstLength + secondLength <= 56) {
+      putWideBits(writer, first << secondLength | second,
+                  firstLength + secondLength);
+    } else {
+      putWideBits(writer, first, firstLength);
+      putWideBits(writer, second, secondLength);
+    }
+  }
+  return i;
+}
+
+/**
+Appends the codes of a run of symbols to a bit stream. Runs long enough to pay
+for finding the longest code go through the wide kernel, and the rest through
+the plain bit writer; both write the same bits.
+@param table is the code table to encode with
+@param in is the symbols to encode
+@param count is the number of symbols
+@param writer is the bit writer to append to, whose buffer has room for
+BIT_WRITER_SLACK bytes past the stream
+*/
+void encodeSymbols(const codeTable *table, const uint8_t *in, size_t count,
+                   bitWriter *writer) {
+  size_t i = 0;
+  if (count >= WIDE_MIN_SYMBOLS) {
+    int maxLength = 0;
+    for (int symbol = 0; symbol < ALPHABET_SIZE; symbol++) {
+      maxLength =
+          table->length[symbol] > maxLength ? table->length[symbol] : maxLength;
+    }
+    if (maxLength <= 28) {
+      drainBits(writer);
+      i = encodeWide(table, in, count, writer);
+    }
+  }
+  for (; i < count; i++) {
+    putBits(writer, table->code[in[i]], table->length[in[i]]);
+  }
+}
+
+/**
+Appends the codes of a run of symbols, each coded with the table of the
+symbol before it. The first symbol is coded as if it followed a 0.
+@param tables is the code table for each preceding symbol
+@param in is the symbols to encode
+@param count is the number of symbols
+@param writer is the bit writer to append to
+*/
+void encodeContextSymbols(const codeTable *const *tables, const uint8_t *in,
+                          size_t count, bitWriter *writer) {
+  const codeTable *table = tables[0];
+  for (size_t i = 0; i < count; i++) {
+    putBits(writer, table->code[in[i]], table->length[in[i]]);
+    table = tables[in[i]];
+  }
+}
+
+/**
+Fills encoder options with the defaults
+@param options is the options to reset
+*/
+void defaultEncoderOptions(encoderOptions *options) {
+  options->builder = BUILD_IN_PLACE;
+  options->maxCodeLength = MAX_CODE_LENGTH;
+  options->blockSize = DEFAULT_BLOCK_SIZE;
+  options->threads = processorCount();
+  options->streams = 1;
+  options->contextOrder = 0;
+}
+
+/**
+Checks that encoder options are in range
+@param options is the settings to check
+@return NULL if they are valid, otherwise what is wrong with them
+*/
+const char *checkEncoderOptions(const encoderOptions *options) {
+  if (options->maxCodeLength < 1 || options->maxCodeLength > MAX_CODE_LENGTH) {
+    return "Code length limit must be 1 to 32 bits";
+  }
+  if (options->blockSize < 1 || options->blockSize > MAX_BLOCK_SIZE) {
+    return "Block size must be 1 to 67108864 bytes";
+  }
+  if (options->streams < 1 || options->streams > MAX_STREAMS) {
+    return "Stream count must be 1 to 16";
+  }
+  if (options->contextOrder < 0 || options->contextOrder > 1) {
+    return "Context order must be 0 or 1";
+  }
+  return NULL;
+}
+
+/**
+Worker task: counts the symbols of the block of a job
+@param argument is the blockJob
+*/
+static void runCountJob(void *argument) {
+  blockJob *job = argument;
+  memset(job->table.frequencies, 0, sizeof(job->table.frequencies));
+  countBytes(job->in, job->size, job->table.frequencies);
+}
+
+/**
+Worker task: compresses the block of a job
+@param argument is the blockJob
+*/
+static void runBlockJob(void *argument) {
+  blockJob *job = argument;
+  uint64_t start = startPhase();
+  job->status =
+      encodeBlock(job->in, job->size, &job->table, job->options, &job->block);
+  endPhase(PHASE_ENCODE, start);
+  countStat(COUNTER_BLOCKS, 1);
+}
+
+/**
+Runs a task for every job of a batch, on the pool if there is one
+@param pool is the thread pool, or NULL to run the tasks on this thread
+@param task is the task to run
+@param jobs is the batch
+@param count is the number of jobs in the batch
+*/
+static void runBatch(threadPool *pool, void (*task)(void *), blockJob *jobs,
+                     int count) {
+  for (int i = 0; i < count; i++) {
+    if (pool != NULL) {
+      submitTask(pool, task, &jobs[i]);
+    } else {
+      task(&jobs[i]);
+    }
+  }
+  if (pool != NULL) {
+    waitForTasks(pool);
+  }
+}
+
+/**
+Writer task: writes the frames of a batch in block order, so the output does
+not depend on which worker finished first, and records them in the index.
+Nothing more is written once a block has failed.
+@param argument is the writeStage
+*/
+static void runWriteJob(void *argument) {
+  writeStage *stage = argument;
+  const batch *current = stage->next;
+  uint64_t start = startPhase();
+  for (int i = 0; i < current->count; i++) {
+    const blockJob *job = &current->jobs[i];
+    if (job->status < 0) {
+      stage->encodeStatus = job->status;
+    }
+    if (stage->encodeStatus < 0 || stage->writeError != 0) {
+      break;
+    }
+    const encodedBlock *block = &job->block;
+    uint8_t *entry = stage->index + (current->first + i) * INDEX_ENTRY_SIZE;
+    store64(entry, stage->outputBytes);
+    store32(entry + 8, job->tableBlock);
+    if (fwrite(block->data, 1, block->size, stage->out) != block->size) {
+      stage->writeError = errno;
+    }
+    stage->outputBytes += block->size;
+    stage->payloadBits += block->payloadBits;
+    stage->optimalBits += block->optimalBits;
+  }
+  endPhase(PHASE_WRITE, start);
+}
+
+/**
+Reports a failure of the writer stage
+@param stage is the writer stage, which must be idle
+@param inPath is the file being compressed
+@param outPath is the file being written
+@param options are the encoder settings
+@return 0 if nothing failed, -1 with a message printed to stderr otherwise
+*/
+static int checkWriteStage(const writeStage *stage, const char *inPath,
+                           const char *outPath,
+                           const encoderOptions *options) {
+  if (stage->encodeStatus == BLOCK_NO_MEMORY) {
+    fprintf(stderr, "%s: out of memory\n", inPath);
+    return -1;
+  }
+  if (stage->encodeStatus < 0) {
+    fprintf(stderr, "%s: codes cannot be limited to %d bits\n", inPath,
+            options->maxCodeLength);
+    return -1;
+  }
+  if (stage->writeError != 0) {
+    /* errno belongs to the writer thread, so perror() would not see it */
+    fprintf(stderr, "%s: %s\n", outPath, strerror(stage->writeError));
+    return -1;
+  }
+  return 0;
+}
+
+/**
+Writes the file header
+@param out is the output file
+@param originalSize is the number of bytes in the original file
+@param blockSize is the number of original bytes per block
+@return 0 on success, -1 on failure
+*/
+static int writeHeader(FILE *out, uint64_t originalSize, uint32_t blockSize) {
+  uint8_t header[HEADER_SIZE];
+  storeMagic(header, MAGIC_FILE);
+  store64(header + 4, originalSize);
+  store32(header + 12, blockSize);
+  return fwrite(header, 1, HEADER_SIZE, out) == HEADER_SIZE ? 0 : -1;
+}
+
+/**
+Writes the block index and the footer that points at it
+@param out is the output file
+@param index is the index entries
+@param blockCount is the number of entries
+@param indexOffset is where in the file the index starts
+@return 0 on success, -1 on failure
+*/
+static int writeIndex(FILE *out, const uint8_t *index, size_t blockCount,
+                      uint64_t indexOffset) {
+  uint8_t footer[FOOTER_SIZE];
+  store64(footer, indexOffset);
+  size_t indexSize = blockCount * INDEX_ENTRY_SIZE;
+  if (fwrite(index, 1, indexSize, out) != indexSize) {
+    return -1;
+  }
+  return fwrite(footer, 1, FOOTER_SIZE, out) == FOOTER_SIZE ? 0 : -1;
+}
+
+/**
+Compresses a file one batch of blocks at a time. A file of more than one batch
+has two batch buffers and a writer thread: while the workers count and code
+one batch, the writer writes out the previous one, which must finish before
+the next is queued, so the coders are never more than one batch ahead of the
+disk. There is no reader thread; the input is mapped, and prefetchInput() asks
+the kernel to read ahead the pages of the next batch.
+@param inPath is the file to compress, or "-" for standard input
+@param outPath is the file to write the compressed data to
+@param options are the encoder settings, or NULL for the defaults
+@param result receives the sizes and time taken, may be NULL
+@return 0 on success, -1 on failure with a message printed to stderr
+*/
+int compressFile(const char *inPath, const char *outPath,
+                 const encoderOptions *options, codingResult *result) {
+  double start = now();
+  encoderOptions defaults;
+  if (options == NULL) {
+    defaultEncoderOptions(&defaults);
+    options = &defaults;
+  }
+  const char *error = checkEncoderOptions(options);
+  if (error != NULL) {
+    fprintf(stderr, "%s\n", error);
+    return -1;
+  }
+  inputSource input;
+  if (openInput(inPath, &input) < 0) {
+    return -1;
+  }
+  FILE *out = fopen(outPath, "wb");
+  if (out == NULL) {
+    perror(outPath);
+    closeInput(&input);
+    return -1;
+  }
+  int threads = options->threads > 0 ? options->threads : 1;
+  threadPool *pool = threads > 1 ? createThreadPool(threads) : NULL;
+  int batchSize = threads * BLOCKS_PER_THREAD;
+  size_t blockSize = (size_t)options->blockSize;
+  size_t blockCount = (input.size + blockSize - 1) / blockSize;
+  /* A file of one batch is written inline, so small files, as in batch mode,
+   * pay for neither a writer thread nor a second buffer */
+  int batchCount = blockCount > (size_t)batchSize ? 2 : 1;
+  threadPool *writer = batchCount > 1 ? createThreadPool(1) : NULL;
+  int batchBlocks = blockCount < (size_t)batchSize ? (int)blockCount
+                                                   : batchSize;
+  /* Every job of a batch codes into its own slot of its batch's buffer */
+  size_t frameBound =
+      blockBound(input.size < blockSize ? input.size : blockSize, options);
+  size_t slots = batchBlocks > 0 ? (size_t)batchBlocks : 1;
+  batch batches[2] = {{0}};
+  writeStage stage = {0};
+  stage.out = out;
+  stage.index = malloc(INDEX_ENTRY_SIZE * (blockCount > 0 ? blockCount : 1));
+  int allocated = stage.index != NULL;
+  for (int k = 0; k < batchCount; k++) {
+    batches[k].jobs = malloc(sizeof(blockJob) * slots);
+    batches[k].frames = malloc(frameBound * slots);
+    allocated = allocated && batches[k].jobs != NULL &&
+                batches[k].frames != NULL;
+  }
+  stage.outputBytes = HEADER_SIZE;
+  /* The last table a frame carried. A BLOCK_CONTEXT frame may stand in for
+   * the table chosen for its block, so order-1 blocks never repeat one. */
+  codeTable previous;
+  uint32_t previousBlock = 0;
+  int havePrevious = 0;
+  int status = -1;
+
+  if (!allocated) {
+    fprintf(stderr, "%s: out of memory\n", inPath);
+    goto done;
+  }
+  if (writeHeader(out, input.size, (uint32_t)blockSize) < 0) {
+    perror(outPath);
+    goto done;
+  }
+  prefetchInput(&input, 0, batchSize * blockSize);
+  for (size_t first = 0; first < blockCount; first += batchSize) {
+    batch *current = &batches[(first / batchSize) % batchCount];
+    current->first = first;
+    current->count = blockCount - first < (size_t)batchSize
+                         ? (int)(blockCount - first)
+                         : batchSize;
+    prefetchInput(&input, (first + batchSize) * blockSize,
+                  batchSize * blockSize);
+    blockJob *jobs = current->jobs;
+    int count = current->count;
+    for (int i = 0; i < count; i++) {
+      size_t offset = (first + i) * blockSize;
+      jobs[i].in = input.data + offset;
+      jobs[i].size = input.size - offset < blockSize ? input.size - offset
+                                                      : blockSize;
+      jobs[i].options = options;
+      jobs[i].block.data = current->frames + i * frameBound;
+      jobs[i].status = 0;
+    }
+    runBatch(pool, runCountJob, jobs, count);
+    /* Tables are chosen in block order, so the output does not depend on the
+     * batch size either */
+    int limitFailed = 0;
+    for (int i = 0; i < count && !limitFailed; i++) {
+      blockTable *table = &jobs[i].table;
+      uint64_t start = startPhase();
+      int chosen =
+          chooseBlockTable(table, havePrevious ? &previous : NULL, options);
+      endPhase(PHASE_TREE, start);
+      if (chosen < 0) {
+        limitFailed = 1;
+      } else if (table->repeat) {
+        jobs[i].tableBlock = previousBlock;
+        countStat(COUNTER_REPEATED_TABLES, 1);
+      } else {
+        jobs[i].tableBlock = (uint32_t)(first + i);
+        if (options->contextOrder == 0 && table->type == BLOCK_HUFFMAN) {
+          previous = table->codes;
+          previousBlock = jobs[i].tableBlock;
+          havePrevious = 1;
+        }
+      }
+    }
+    if (limitFailed) {
+      fprintf(stderr, "%s: codes cannot be limited to %d bits\n", inPath,
+              options->maxCodeLength);
+      goto done;
+    }
+    runBatch(pool, runBlockJob, jobs, count);
+    /* The previous batch has to be out before this one is queued behind it,
+     * which also frees its buffer for the next batch */
+    if (writer != NULL) {
+      waitForTasks(writer);
+    }
+    if (checkWriteStage(&stage, inPath, outPath, options) < 0) {
+      goto done;
+    }
+    stage.next = current;
+    if (writer != NULL) {
+      submitTask(writer, runWriteJob, &stage);
+    } else {
+      runWriteJob(&stage);
+    }
+  }
+  if (writer != NULL) {
+    waitForTasks(writer);
+  }
+  if (checkWriteStage(&stage, inPath, outPath, options) < 0) {
+    goto done;
+  }
+  if (writeIndex(out, stage.index, blockCount, stage.outputBytes) < 0) {
+    perror(outPath);
+    goto done;
+  }
+  status = 0;
+  uint64_t outputBytes =
+      stage.outputBytes + blockCount * INDEX_ENTRY_SIZE + FOOTER_SIZE;
+  countStat(COUNTER_BYTES_IN, input.size);
+  countStat(COUNTER_BYTES_OUT, outputBytes);
+  if (result != NULL) {
+    result->inputBytes = input.size;
+    result->outputBytes = outputBytes;
+    result->payloadBits = stage.payloadBits;
+    result->optimalBits = stage.optimalBits;
+  }
+
+done:
+  /* Destroying the writer finishes its queued batch before the file closes */
+  if (writer != NULL) {
+    destroyThreadPool(writer);
+  }
+  if (pool != NULL) {
+    destroyThreadPool(pool);
+  }
+  for (int k = 0; k < batchCount; k++) {
+    free(batches[k].jobs);
+    free(batches[k].frames);
+  }
+  free(stage.index);
+  closeInput(&input);
+  if (fclose(out) != 0 && status == 0) {
+    perror(outPath);
+    status = -1;
+  }
+  if (result != NULL) {
+    result->seconds = now() - start;
+  }
+  return status;
+}
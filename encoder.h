@@ -0,0 +1,110 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file contains the interface for compressing a file with
+        huffman codes. See format.h for the layout of the output. The
+        output only depends on the options that shape it, never on the
+        number of threads.
+
+*/
+
+#ifndef _ENCODER_H_
+#define _ENCODER_H_
+
+#include "bitio.h"
+#include "huffman.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+Sizes and timing of a single compression or decompression run
+*/
+typedef struct CodingResult {
+  uint64_t inputBytes;  /**< Bytes read from the input file */
+  uint64_t outputBytes; /**< Bytes written to the output file */
+  double seconds;       /**< Wall clock time spent */
+  uint64_t payloadBits; /**< Bits of huffman coded data */
+  uint64_t optimalBits; /**< Payload bits without a code length limit */
+} codingResult;
+
+/** Default number of original bytes per block */
+#define DEFAULT_BLOCK_SIZE (1 << 20)
+/** Largest block size, which keeps every frame size within 32 bits */
+#define MAX_BLOCK_SIZE (1 << 26)
+
+/**
+How code lengths are computed from the symbol frequencies
+*/
+typedef enum TreeBuilder {
+  BUILD_IN_PLACE, /**< Sort once and compute lengths in place */
+  BUILD_HEAP      /**< Build a pointer tree with the min heap */
+} treeBuilder;
+
+/**
+Settings for compressFile() and createCompressor()
+*/
+typedef struct EncoderOptions {
+  treeBuilder builder; /**< How code lengths are computed */
+  int maxCodeLength;   /**< Longest code allowed, up to MAX_CODE_LENGTH */
+  int blockSize;       /**< Original bytes per block, up to MAX_BLOCK_SIZE */
+  int threads;         /**< Worker threads compressing blocks */
+  int streams;         /**< Streams per block, up to MAX_STREAMS */
+  int contextOrder;    /**< 1 to code each byte by the byte before it */
+} encoderOptions;
+
+/**
+Fills encoder options with the defaults
+@param options is the options to reset
+*/
+void defaultEncoderOptions(encoderOptions *options);
+
+/**
+Checks that encoder options are in range
+@param options is the settings to check
+@return NULL if they are valid, otherwise what is wrong with them
+*/
+const char *checkEncoderOptions(const encoderOptions *options);
+
+/**
+Appends the codes of a run of symbols to a bit stream
+@param table is the code table to encode with
+@param in is the symbols to encode
+@param count is the number of symbols
+@param writer is the bit writer to append to, whose buffer has room for
+BIT_WRITER_SLACK bytes past the stream
+*/
+void encodeSymbols(const codeTable *table, const uint8_t *in, size_t count,
+                   bitWriter *writer);
+
+/**
+Appends the codes of a run of symbols, each coded with the table of the
+symbol before it. The first symbol is coded as if it followed a 0.
+@param tables is the code table for each preceding symbol
+@param in is the symbols to encode
+@param count is the number of symbols
+@param writer is the bit writer to append to
+*/
+void encodeContextSymbols(const codeTable *const *tables, const uint8_t *in,
+                          size_t count, bitWriter *writer);
+
+/**
+Compresses a file
+@param inPath is the file to compress, or "-" for standard input
+@param outPath is the file to write the compressed data to
+@param options are the encoder settings, or NULL for the defaults
+@param result receives the sizes and time taken, may be NULL
+@return 0 on success, -1 on failure with a message printed to stderr
+*/
+int compressFile(const char *inPath, const char *outPath,
+                 const encoderOptions *options, codingResult *result);
+
+/**
+Monotonic clock in seconds, used for throughput reports
+@return seconds since an arbitrary point in the past
+*/
+double now(void);
+
+#endif
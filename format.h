@@ -0,0 +1,240 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file describes the layout of compressed files and contains
+        helpers for reading and writing little endian header fields.
+
+        Layout:
+          4 bytes   magic "HUF" followed by FORMAT_VERSION
+          8 bytes   number of bytes in the original file
+          4 bytes   block size: the original is split into blocks of this
+                    many bytes, the last one may be shorter
+          ...       one frame per block, in order:
+            1 byte    block type
+            4 bytes   number of bytes in the rest of the frame
+            ...       code lengths, see writeCodeLengths()
+            ...       huffman coded payload using canonical codes, padded
+                      with zero bits
+          A BLOCK_STREAMS frame splits the payload into n streams that
+          cover consecutive runs of the block, see streamStart():
+            ...       code lengths
+            1 byte    number of streams n
+            (n-1) * 4 size of every stream but the last
+            ...       the streams, each padded with zero bits
+          A BLOCK_CONTEXT frame codes every byte with the table of the byte
+          before it (0 for the first byte of the block):
+            32 bytes  bit per preceding byte that has a table of its own
+            ...       code lengths shared by all other preceding bytes
+            ...       code lengths of each own table, by preceding byte
+            ...       payload, padded with zero bits
+          A BLOCK_RAW frame stores the block as it is, and a BLOCK_RUN
+          frame holds the one byte value that fills the whole block:
+            ...       the original bytes, or the one byte value
+          A frame whose type has the BLOCK_REPEAT_TABLE flag leaves out the
+          code lengths and uses those of the block its index entry names.
+          Readers reject a frame of any other type as unsupported.
+          block index, one entry per block; block i starts at original
+          byte i * block size:
+            8 bytes   offset of the block's frame in the file
+            4 bytes   block whose frame holds the code lengths it uses: the
+                      block itself, or an earlier block with its own lengths
+          8 bytes   offset of the block index in the file
+
+        Block streams, see codec.h, are read front to back and need no
+        index or size up front:
+          4 bytes   magic "HUB" followed by FORMAT_VERSION
+          4 bytes   block size
+          ...       per block:
+            4 bytes   number of original bytes in the block
+            ...       its frame, as in a compressed file
+          4 bytes   zero, which ends the stream
+          A frame with the BLOCK_REPEAT_TABLE flag uses the code lengths of
+          the last BLOCK_HUFFMAN or BLOCK_STREAMS frame that has its own.
+
+        Archives, see batch.h, hold many block streams one after another:
+          4 bytes   magic "HUA" followed by FORMAT_VERSION
+          ...       per member:
+            2 bytes   number of bytes in the path
+            ...       path the member is extracted to, relative and without
+                      a terminating zero
+            8 bytes   number of bytes in the block stream
+            ...       the block stream
+          2 bytes   zero, which ends the archive, so that one cut short
+                    between two members is not taken for a whole one
+
+        Adaptive streams, see adaptive.h, have no blocks or tables:
+          4 bytes   magic "HUS" followed by FORMAT_VERSION
+          ...       adaptive huffman codes up to and including the end of
+                    stream symbol, padded with zero bits
+
+        Shared table files, see shared.h:
+          4 bytes   magic "HUT" followed by FORMAT_VERSION
+          4 bytes   table ID
+          ...       code lengths
+
+        Records coded with a shared table:
+          1 byte    RECORD_MARKER, or RECORD_RAW_MARKER if the table could
+                    not shrink the original bytes
+          4 bytes   table ID
+          1-10      number of original bytes, 7 bits per byte, low bits first,
+                    high bit set on all but the last byte
+          ...       payload, padded with zero bits, or the original bytes
+
+*/
+
+#ifndef _FORMAT_H_
+#define _FORMAT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Third magic byte of a compressed file */
+#define MAGIC_FILE 'F'
+/** Third magic byte of a block stream */
+#define MAGIC_BLOCKS 'B'
+/** Third magic byte of an archive */
+#define MAGIC_ARCHIVE 'A'
+/** Third magic byte of an adaptive stream */
+#define MAGIC_STREAM 'S'
+/** Third magic byte of a shared table file */
+#define MAGIC_TABLE 'T'
+/** First byte of a record coded with a shared table. It differs from the 'H'
+ that starts every other file. */
+#define RECORD_MARKER 0xF4
+/** First byte of a record that holds its original bytes as they are */
+#define RECORD_RAW_MARKER 0xF5
+/** Version byte that follows the magic. Files of any other version are
+ rejected, so it changes with every new frame type or layout: version 5
+ added BLOCK_STREAMS, BLOCK_CONTEXT, BLOCK_RAW, BLOCK_RUN and
+ BLOCK_REPEAT_TABLE to the frames of version 4. */
+#define FORMAT_VERSION 5
+/** Size of the file header */
+#define HEADER_SIZE 16
+/** Size of the type and size fields that start every block frame */
+#define BLOCK_HEADER_SIZE 5
+/** Size of the smallest block frame, a BLOCK_RUN header and its byte value */
+#define MIN_FRAME_SIZE (BLOCK_HEADER_SIZE + 1)
+/** Size of one block index entry */
+#define INDEX_ENTRY_SIZE 12
+/** Size of the index offset that ends the file */
+#define FOOTER_SIZE 8
+/** Size of the header of a block stream */
+#define BLOCK_STREAM_HEADER_SIZE 8
+/** Size of the original size in front of each frame of a block stream */
+#define BLOCK_PREFIX_SIZE 4
+/** Size of the header of an archive */
+#define ARCHIVE_HEADER_SIZE 4
+/** Size of the zero path size that ends an archive */
+#define ARCHIVE_FOOTER_SIZE 2
+/** Longest path of an archive member */
+#define MAX_MEMBER_PATH 0xFFFF
+
+/** Largest number of streams in a BLOCK_STREAMS frame */
+#define MAX_STREAMS 16
+
+/** Size of the map of contexts with their own table in a BLOCK_CONTEXT frame */
+#define CONTEXT_MAP_SIZE 32
+
+/** Block types */
+enum { BLOCK_HUFFMAN, BLOCK_STREAMS, BLOCK_CONTEXT, BLOCK_RAW, BLOCK_RUN };
+/** Flag on the type of a BLOCK_HUFFMAN or BLOCK_STREAMS frame that leaves out
+ its code lengths and repeats those of an earlier frame */
+#define BLOCK_REPEAT_TABLE 0x80
+
+/**
+ Where a stream starts when a block is split into streams. Every stream but
+ the last covers the same number of symbols.
+ @param count is the number of symbols in the block
+ @param streamCount is the number of streams
+ @param k is the stream, 0 to streamCount (streamCount gives the end)
+ @return index of the first symbol of stream k
+ */
+static inline size_t streamStart(size_t count, int streamCount, int k) {
+  size_t length = (count + streamCount - 1) / streamCount;
+  return length * k < count ? length * k : count;
+}
+
+/**
+ Store a 16 bit value in little endian order
+ @param out is where to store the value
+ @param value is the value to store
+ */
+static inline void store16(uint8_t *out, uint16_t value) {
+  out[0] = (uint8_t)value;
+  out[1] = (uint8_t)(value >> 8);
+}
+
+/**
+ Store a 32 bit value in little endian order
+ @param out is where to store the value
+ @param value is the value to store
+ */
+static inline void store32(uint8_t *out, uint32_t value) {
+  store16(out, (uint16_t)value);
+  store16(out + 2, (uint16_t)(value >> 16));
+}
+
+/**
+ Store a 64 bit value in little endian order
+ @param out is where to store the value
+ @param value is the value to store
+ */
+static inline void store64(uint8_t *out, uint64_t value) {
+  store32(out, (uint32_t)value);
+  store32(out + 4, (uint32_t)(value >> 32));
+}
+
+/**
+ Load a 16 bit little endian value
+ @param in is where to read from
+ @return the value
+ */
+static inline uint16_t load16(const uint8_t *in) {
+  return (uint16_t)(in[0] | in[1] << 8);
+}
+
+/**
+ Load a 32 bit little endian value
+ @param in is where to read from
+ @return the value
+ */
+static inline uint32_t load32(const uint8_t *in) {
+  return load16(in) | (uint32_t)load16(in + 2) << 16;
+}
+
+/**
+ Load a 64 bit little endian value
+ @param in is where to read from
+ @return the value
+ */
+static inline uint64_t load64(const uint8_t *in) {
+  return load32(in) | (uint64_t)load32(in + 4) << 32;
+}
+
+/**
+ Check whether a buffer starts with a magic
+ @param in is the start of the file, at least 4 bytes long
+ @param kind is the MAGIC_ kind to check for
+ @return nonzero if the magic, kind and version match
+ */
+static inline int checkMagic(const uint8_t *in, char kind) {
+  return in[0] == 'H' && in[1] == 'U' && in[2] == kind &&
+         in[3] == FORMAT_VERSION;
+}
+
+/**
+ Write a magic
+ @param out is where to write 4 bytes
+ @param kind is the MAGIC_ kind of the file
+ */
+static inline void storeMagic(uint8_t *out, char kind) {
+  out[0] = 'H';
+  out[1] = 'U';
+  out[2] = kind;
+  out[3] = FORMAT_VERSION;
+}
+
+#endif
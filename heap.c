@@ -9,45 +9,18 @@
 
  */
 #include "heap.h"
+#include "stats.h"
 #include <stdbool.h>
-#include <string.h>
 
 /**
- Create a new empty heap
- @return A pointer to the new heap
+ Empty a heap and its node pool
+ @param myHeap is the heap to reset
+ @param capacity is the maximum number of items, up to MAX_LEAVES
  */
-heap *makenull(int capacity) {
-  heap *newHeap = malloc(sizeof(heap));
-  newHeap->maxSize = capacity;
-  newHeap->currentSize = 0;
-  node **data = malloc(sizeof(node *) * capacity);
-  newHeap->data = data;
-  return newHeap;
-}
-
-/**
-Helper function that recursively deletes nodes in tree
-@param myNode is the current node to delete
-*/
-void deleteHuffmanHelper(node *myNode) {
-  if (myNode == NULL) {
-    return;
-  }
-  deleteHuffmanHelper(myNode->leftChild);
-  deleteHuffmanHelper(myNode->rightChild);
-  free(myNode);
-}
-
-/**
-This function deletes all the data used by the huffman tree.
-@param myHeap is the heap to delete
-*/
-void deleteHuffman(heap *myHeap) {
-  for (int i = 0; i < myHeap->currentSize; i++) {
-    deleteHuffmanHelper(myHeap->data[i]);
-  }
-  free(myHeap->data);
-  free(myHeap);
+void makenull(heap *myHeap, int capacity) {
+  myHeap->maxSize = capacity < MAX_LEAVES ? capacity : MAX_LEAVES;
+  myHeap->currentSize = 0;
+  myHeap->nodeCount = 0;
 }
 
 /**
@@ -55,32 +28,33 @@ void deleteHuffman(heap *myHeap) {
  @param myHeap is a pointer to the heap
  @return true if empty and false otherwise
  */
-bool empty(heap *myHeap) { return myHeap->data == NULL ? true : false; }
+bool empty(const heap *myHeap) { return myHeap->currentSize == 0; }
 
 /**
  What is the smallest value in the heap?
  @param myHeap is the heap to find min of
- @return The node containing the smallest frequency in the heap, NULL if heap is
- empty
+ @return Index of the node with the smallest frequency, NO_CHILD if the heap
+ is empty
  */
-node *min(heap *myHeap) { return !(empty(myHeap)) ? myHeap->data[0] : NULL; }
+int min(const heap *myHeap) {
+  return !(empty(myHeap)) ? myHeap->data[0] : NO_CHILD;
+}
 
 /**
 This function combines min() and deletemin() into one function to avoid
 repetition
 @param myHeap is the heap to grab the min value from
-@return node with the most minimum frequency value
+@return index of the node with the most minimum frequency value
 */
-node *extractMin(heap *myHeap) {
-  node *minNode = min(myHeap);
+int extractMin(heap *myHeap) {
+  int minNode = min(myHeap);
   deletemin(myHeap);
   return minNode;
 }
 
 /**
  Delete the minimum from the heap
- @param myHeap is the heap to delete fronode *min(heap *myHeap) { return
- !(empty(myHeap)) ? myHeap->data[0] : NULL; }m
+ @param myHeap is the heap to delete from
  */
 void deletemin(heap *myHeap) {
   if (empty(myHeap))
@@ -89,9 +63,20 @@ void deletemin(heap *myHeap) {
   /* swap the min and the tail */
   swap(myHeap, 0, tailIndex);
   myHeap->currentSize--;
+  countStat(COUNTER_HEAP_SIFTS, 1);
   downheap(myHeap, 0);
 }
 
+/**
+ Frequency of the node at index i of the heap
+ @param myHeap is the heap to look in
+ @param i is the heap index
+ @return the frequency of the node stored there
+ */
+static inline uint64_t frequencyAt(const heap *myHeap, int i) {
+  return myHeap->nodes[myHeap->data[i]].frequency;
+}
+
 /**
  Downheap starting at the node at index i
  @param myHeap is the heap to modify
@@ -102,91 +87,94 @@ void downheap(heap *myHeap, int i) {
   int rightIndex = rightChild(i);
   if (leftIndex >= myHeap->currentSize) // No Children
     return;
-  /* Get child with minimum value */
-  int minIndex =
-      myHeap->data[leftIndex]->frequency <= myHeap->data[rightIndex]->frequency
-          ? leftIndex
-          : rightIndex;
-  /* Edge case: Right Child is smaller but out of bounds */
-  if (rightIndex >= myHeap->currentSize) {
-    minIndex = leftIndex;
-  }
-  if (myHeap->data[i]->frequency > myHeap->data[minIndex]->frequency) {
+  /* Get child with minimum value. Edge case: Right Child is out of bounds */
+  int minIndex = rightIndex >= myHeap->currentSize ||
+                         frequencyAt(myHeap, leftIndex) <=
+                             frequencyAt(myHeap, rightIndex)
+                     ? leftIndex
+                     : rightIndex;
+  if (frequencyAt(myHeap, i) > frequencyAt(myHeap, minIndex)) {
     /* Swap the value of parent with minIndex child */
+    countStat(COUNTER_SIFT_STEPS, 1);
     swap(myHeap, i, minIndex);
     downheap(myHeap, minIndex);
   }
 }
 /**
-Wrapper function that initializes a new node
-@param frequency is the probability of an ASCII character appearing in textfile
+Takes a new node from the pool of a heap
+@param myHeap is the heap whose pool the node comes from
+@param frequency is the number of times the character appears in textfile
 @param asciiValue is the ASCII value in question
+@return index of the node
 */
-node *createNode(double frequency, int asciiValue) {
-  node *newNode = malloc(sizeof(node));
+int createNode(heap *myHeap, uint64_t frequency, int asciiValue) {
+  int index = myHeap->nodeCount++;
+  countStat(COUNTER_NODES, 1);
+  node *newNode = &myHeap->nodes[index];
   newNode->frequency = frequency;
   newNode->asciiValue = asciiValue;
-  newNode->leftChild = NULL;
-  newNode->rightChild = NULL;
-  return newNode;
+  newNode->leftChild = NO_CHILD;
+  newNode->rightChild = NO_CHILD;
+  return index;
 }
 
 /**
 Alternate function to insert() but inserts node to heap
-@param newNode to insert to heap
-@param heap to insert node into
+@param newNode is the index of the node to insert
+@param myHeap is the heap to insert the node into
 */
-void insertNode(node *newNode, heap *myHeap) {
+void insertNode(int newNode, heap *myHeap) {
   int size = myHeap->currentSize;
   /* size == capacity */
   if (size == myHeap->maxSize) {
     return;
   }
-  myHeap->data[size] = newNode;
+  myHeap->data[size] = (uint16_t)newNode;
   myHeap->currentSize++;
   /* Note: size also refers to index inserted */
+  countStat(COUNTER_HEAP_SIFTS, 1);
   upheap(myHeap, size);
 }
 
 /**
 This function combines two trees/nodes together by creating a new node and
 setting nodes passed to the function as its children
+@param myHeap is the heap whose pool holds the nodes
 @param node01 first node
 @param node02 second node
-@return parent node or root of tree
+@return index of the parent node or root of tree
 */
-node *combineNodes(node *node01, node *node02) {
-  double frequency01 = node01->frequency;
-  double frequency02 = node02->frequency;
-  double totalFrequency = frequency01 + frequency02;
-  node *newNode = createNode(totalFrequency, -1);
-  if (frequency01 == frequency02) {
-    newNode->leftChild =
-        (node01->asciiValue < node02->asciiValue) ? node01 : node02;
-    newNode->rightChild =
-        (node01->asciiValue > node02->asciiValue) ? node01 : node02;
-  } else {
-    newNode->leftChild = (frequency01 < frequency02) ? node01 : node02;
-    newNode->rightChild = (frequency01 > frequency02) ? node01 : node02;
-  }
+int combineNodes(heap *myHeap, int node01, int node02) {
+  uint64_t frequency01 = myHeap->nodes[node01].frequency;
+  uint64_t frequency02 = myHeap->nodes[node02].frequency;
+  int newNode = createNode(myHeap, frequency01 + frequency02, -1);
+  /* Ties go to the smaller ASCII value; two internal nodes (both -1) keep
+   * their order so that neither child is lost */
+  bool firstIsLeft = (frequency01 == frequency02)
+                         ? myHeap->nodes[node01].asciiValue <=
+                               myHeap->nodes[node02].asciiValue
+                         : frequency01 < frequency02;
+  myHeap->nodes[newNode].leftChild = firstIsLeft ? node01 : node02;
+  myHeap->nodes[newNode].rightChild = firstIsLeft ? node02 : node01;
   return newNode;
 }
 
 /**
  Insert value x into the heap
- @param x is the value to insert
+ @param frequency is the number of times the character appears
+ @param asciiValue is the ASCII value in question
  @param myHeap is the heap to insert into
  */
-void insert(double frequency, int asciiValue, heap *myHeap) {
+void insert(uint64_t frequency, int asciiValue, heap *myHeap) {
   int size = myHeap->currentSize;
   /* size == capacity */
   if (size == myHeap->maxSize) {
     return;
   }
-  node *newNode = createNode(frequency, asciiValue);
-  myHeap->data[size] = newNode;
+  myHeap->data[size] = (uint16_t)createNode(myHeap, frequency, asciiValue);
   myHeap->currentSize++;
   /* Note: size also refers to index inserted */
+  countStat(COUNTER_HEAP_SIFTS, 1);
   upheap(myHeap, size);
 }
 
@@ -199,7 +187,8 @@ void upheap(heap *myHeap, int i) {
   int parentIndex = parent(i);
   if (parentIndex < 0)
     return; /* If root, then return */
-  if (myHeap->data[parentIndex]->frequency > myHeap->data[i]->frequency) {
+  if (frequencyAt(myHeap, parentIndex) > frequencyAt(myHeap, i)) {
+    countStat(COUNTER_SIFT_STEPS, 1);
     swap(myHeap, parentIndex, i);
     upheap(myHeap, parentIndex);
   }
@@ -234,65 +223,7 @@ int rightChild(int n) { return (n + 1) * 2; }
  */
 void swap(heap *myHeap, int i, int j) {
   /* Assuming valid indices */
-  node *temp = myHeap->data[i];
+  uint16_t temp = myHeap->data[i];
   myHeap->data[i] = myHeap->data[j];
   myHeap->data[j] = temp;
 }
-
-/**
-This recursive function searches for an ASCII value in the huffman tree.
-For efficiency reasons, it will also build a huffman code as a string
-as it traverses the tree.
-@param target is the ASCII value to find
-@param huffmanCode is the string passed to each recursive call
-@param count keeps track of current index of huffmanCode string
-@param nodePtr as the root node
-@return node containing ASCII value, or NULL if it doesn't exist
-*/
-node *searchForAscii(int target, char *huffmanCode, int count, node *nodePtr) {
-  if (nodePtr == NULL)
-    return NULL;
-  if (target == nodePtr->asciiValue) {
-    huffmanCode[count] = '\0';
-    return nodePtr;
-  }
-  if (nodePtr->leftChild != NULL) {
-    huffmanCode[count] = '0';
-    node *result =
-        searchForAscii(target, huffmanCode, count + 1, nodePtr->leftChild);
-    if (result != NULL)
-      return result;
-  }
-  if (nodePtr->rightChild != NULL) {
-    huffmanCode[count] = '1';
-    node *result =
-        searchForAscii(target, huffmanCode, count + 1, nodePtr->rightChild);
-    if (result != NULL)
-      return result;
-  }
-
-  return NULL;
-}
-
-/**
- This function prints the Huffman tree
- @param myHeap is the heap to print
- */
-void printHuffman(heap *myHeap) {
-  printf("| %5s | %s | %s |\n", "ASCII", "Percent", "Code");
-  printf("| ----- | ------- | ---- |\n");
-  // int totalBits = 0;
-  for (int value = 0; value < 128; value++) {
-    char *huffmanCode = malloc(sizeof(char) * 127);
-    node *nodePtr = searchForAscii(value, huffmanCode, 0, myHeap->data[0]);
-    if (nodePtr == NULL) {
-      free(huffmanCode);
-      continue;
-    }
-    printf("| %5d | %1.5f | %s |\n", nodePtr->asciiValue, nodePtr->frequency,
-           huffmanCode);
-    // totalBits += (nodePtr->frequency * 100 * strlen(huffmanCode));
-    free(huffmanCode);
-  }
-  // printf("Total Bits: %d\n", totalBits);
-}
@@ -5,7 +5,7 @@
         @section DESCRIPTION
 
         This file contains the interface for a min heap data structure,
-        using an array of node pointers to organize a huffman tree.
+        using an array of node indices to organize a huffman tree.
 
 */
 
@@ -13,69 +13,71 @@
 #define _HEAP_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+
+/** Most leaves a heap can hold, one per byte value */
+#define MAX_LEAVES 256
+/** Most nodes a tree over MAX_LEAVES leaves can have */
+#define MAX_NODES (2 * MAX_LEAVES - 1)
+/** Child index of a leaf */
+#define NO_CHILD UINT16_MAX
+
 /**
 Node which contains a left node that is conventionally smaller than the right
 node.
 Stores the frequency (what's being compared) and the ASCII representation of the
-char
+char. Children are indices into the node pool of the heap.
 */
 typedef struct Node {
-  double frequency;        /**< Probability of ASCII value */
-  int asciiValue;          /**< Character stored as ASCII value */
-  struct Node *leftChild;  /**< Left child pointer */
-  struct Node *rightChild; /**< Right child pointer */
+  uint64_t frequency;  /**< Number of times the ASCII value appears */
+  int asciiValue;      /**< Character stored as ASCII value, -1 if internal */
+  uint16_t leftChild;  /**< Left child index, NO_CHILD for a leaf */
+  uint16_t rightChild; /**< Right child index, NO_CHILD for a leaf */
 } node;
 /**
         A structure to represent a heap (Priority Queue / Min Heap) Data
-   Structure.
+   Structure. Nodes are allocated from a pool inside the heap, so building
+   and dropping a tree never calls malloc or free.
  */
 
 typedef struct Heap {
-  node **data;     /**< A pointer to your array of nodes. */
-  int maxSize;     /**< The maximum size of the heap before it needs to be
-                      resized.*/
+  node nodes[MAX_NODES];     /**< Pool every node is allocated from */
+  int nodeCount;             /**< Number of nodes used in the pool */
+  uint16_t data[MAX_LEAVES]; /**< Node indices in heap order */
+  int maxSize;     /**< The maximum number of items in the heap */
   int currentSize; /**< The current number of items in the array. */
 } heap;
 
 /**
- Create a new empty Heap
- @return A pointer to the new heap
+ Empty a heap and its node pool
+ @param myHeap is the heap to reset
+ @param capacity is the maximum number of items, up to MAX_LEAVES
  */
-heap *makenull(int capacity);
-/**
-Helper function that recursively deletes nodes in tree
-@param myNode is the current node to delete
-*/
-void deleteHuffmanHelper(node *myNode);
-
-/**
-This function deletes all the data used by the huffman tree.
-@param myHeap is the heap to delete
-*/
-void deleteHuffman(heap *myHeap);
+void makenull(heap *myHeap, int capacity);
 
 /**
  Ask if the heap is currently empty
  @param myHeap is a pointer to the heap
  @return true if empty and false otherwise
  */
-bool empty(heap *myHeap);
+bool empty(const heap *myHeap);
 
 /**
  What is the smallest value in the heap?
  @param myHeap is the heap to find min of
- @return The smallest value in the heap
+ @return Index of the node with the smallest frequency, NO_CHILD if the heap
+ is empty
  */
-node *min(heap *myHeap);
+int min(const heap *myHeap);
 /**
 This function combines min() and deletemin() into one function to avoid
 repetition
 @param myHeap is the heap to grab the min value from
-@return node with the most minimum frequency value
+@return index of the node with the most minimum frequency value
 */
-node *extractMin(heap *myHeap);
+int extractMin(heap *myHeap);
 
 /**
  Delete the minimum from the heap
@@ -90,34 +92,38 @@ void deletemin(heap *myHeap);
  */
 void downheap(heap *myHeap, int i);
 /**
-Wrapper function that initializes a new node
-@param frequency is the probability of an ASCII character appearing in textfile
+Takes a new node from the pool of a heap
+@param myHeap is the heap whose pool the node comes from
+@param frequency is the number of times the character appears in textfile
 @param asciiValue is the ASCII value in question
+@return index of the node
 */
-node *createNode(double frequency, int asciiValue);
+int createNode(heap *myHeap, uint64_t frequency, int asciiValue);
 /**
 Alternate function to insert() but inserts node to heap
-@param newNode to insert to heap
-@param heap to insert node into
+@param newNode is the index of the node to insert
+@param myHeap is the heap to insert the node into
 */
 
-void insertNode(node *newNode, heap *myHeap);
+void insertNode(int newNode, heap *myHeap);
 
 /**
 This function combines two trees/nodes together by creating a new node and
 setting nodes passed to the function as its children
+@param myHeap is the heap whose pool holds the nodes
 @param node01 first node
 @param node02 second node
-@return parent node or root of tree
+@return index of the parent node or root of tree
 */
-node *combineNodes(node *node01, node *node02);
+int combineNodes(heap *myHeap, int node01, int node02);
 
 /**
  Insert value x into the Heap
- @param x is the value to insert
+ @param frequency is the number of times the character appears
+ @param asciiValue is the ASCII value in question
  @param myHeap is the heap to insert into
  */
-void insert(double frequency, int asciiValue, heap *myHeap);
+void insert(uint64_t frequency, int asciiValue, heap *myHeap);
 
 /**
  Upheap starting at node indexed to i
@@ -154,21 +160,4 @@ int rightChild(int n);
  @param j is the second index to swap with
  */
 void swap(heap *myHeap, int i, int j);
-/**
-This recursive function searches for an ASCII value in the huffman tree.
-For efficiency reasons, it will also build a huffman code as a string
-as it traverses the tree.
-@param target is the ASCII value to find
-@param huffmanCode is the string passed to each recursive call
-@param count keeps track of current index of huffmanCode string
-@param nodePtr as the root node
-@return node containing ASCII value, or NULL if it doesn't exist
-*/
-node *searchForAscii(int target, char *huffmanCode, int count, node *nodePtr);
-/**
- This function prints the Huffman tree
- @param myHeap is the heap to print
- */
-void printHuffman(heap *myHeap);
-
 #endif
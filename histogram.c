@@ -0,0 +1,91 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file implements the byte histogram. Eight bytes are loaded at
+        a time and each goes to one of four 32-bit sub-histograms, which
+        keeps the increments of consecutive equal bytes independent.
+
+ */
+#include "histogram.h"
+#include "stats.h"
+#include <math.h>
+#include <string.h>
+
+/** Number of interleaved sub-histograms */
+#define HISTOGRAM_TABLES 4
+/** Bytes counted before the 32-bit sub-histograms are merged */
+#define HISTOGRAM_PIECE (1u << 30)
+
+/**
+Adds the number of times each byte value appears in a buffer to counts. Bytes
+are spread over several interleaved sub-histograms that are merged at the end,
+so runs of the same byte do not wait on the previous increment of one counter.
+@param data is the buffer to count
+@param size is the number of bytes in data
+@param counts is an array of 256 counters to add to
+*/
+void countBytes(const uint8_t *data, size_t size, uint64_t *counts) {
+  uint64_t start = startPhase();
+  uint32_t tables[HISTOGRAM_TABLES][256];
+  while (size > 0) {
+    size_t piece = size < HISTOGRAM_PIECE ? size : HISTOGRAM_PIECE;
+    const uint8_t *ptr = data;
+    const uint8_t *end = data + piece;
+    memset(tables, 0, sizeof(tables));
+    while (end - ptr >= 16) {
+      uint64_t first, second;
+      memcpy(&first, ptr, sizeof(first));
+      memcpy(&second, ptr + 8, sizeof(second));
+      tables[0][(uint8_t)first]++;
+      tables[1][(uint8_t)(first >> 8)]++;
+      tables[2][(uint8_t)(first >> 16)]++;
+      tables[3][(uint8_t)(first >> 24)]++;
+      tables[0][(uint8_t)(first >> 32)]++;
+      tables[1][(uint8_t)(first >> 40)]++;
+      tables[2][(uint8_t)(first >> 48)]++;
+      tables[3][first >> 56]++;
+      tables[0][(uint8_t)second]++;
+      tables[1][(uint8_t)(second >> 8)]++;
+      tables[2][(uint8_t)(second >> 16)]++;
+      tables[3][(uint8_t)(second >> 24)]++;
+      tables[0][(uint8_t)(second >> 32)]++;
+      tables[1][(uint8_t)(second >> 40)]++;
+      tables[2][(uint8_t)(second >> 48)]++;
+      tables[3][second >> 56]++;
+      ptr += 16;
+    }
+    while (ptr < end) {
+      tables[0][*ptr++]++;
+    }
+    for (int value = 0; value < 256; value++) {
+      counts[value] += (uint64_t)tables[0][value] + tables[1][value] +
+                       tables[2][value] + tables[3][value];
+    }
+    data += piece;
+    size -= piece;
+  }
+  endPhase(PHASE_HISTOGRAM, start);
+}
+
+/**
+Size of a histogram's symbols under an ideal code, which no prefix code can
+beat: the sum over symbols of count * log2(total / count)
+@param counts is an array of 256 counters
+@return the entropy of the histogram in bits
+*/
+double entropyBits(const uint64_t *counts) {
+  uint64_t total = 0;
+  for (int symbol = 0; symbol < 256; symbol++) {
+    total += counts[symbol];
+  }
+  double bits = 0;
+  for (int symbol = 0; symbol < 256; symbol++) {
+    if (counts[symbol] > 0) {
+      bits += counts[symbol] * log2((double)total / counts[symbol]);
+    }
+  }
+  return bits;
+}
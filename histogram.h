@@ -0,0 +1,35 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file contains the interface for counting byte frequencies.
+
+*/
+
+#ifndef _HISTOGRAM_H_
+#define _HISTOGRAM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+Adds the number of times each byte value appears in a buffer to counts. Bytes
+are spread over several interleaved sub-histograms that are merged at the end,
+so runs of the same byte do not wait on the previous increment of one counter.
+@param data is the buffer to count
+@param size is the number of bytes in data
+@param counts is an array of 256 counters to add to
+*/
+void countBytes(const uint8_t *data, size_t size, uint64_t *counts);
+
+/**
+Size of a histogram's symbols under an ideal code, which no prefix code can
+beat: the sum over symbols of count * log2(total / count)
+@param counts is an array of 256 counters
+@return the entropy of the histogram in bits
+*/
+double entropyBits(const uint64_t *counts);
+
+#endif
@@ -0,0 +1,514 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file implements huffman tree construction, the conversion
+        from a tree to a flat code table, in-place code length computation,
+        canonical code assignment and the compact code length header.
+
+ */
+#include "huffman.h"
+#include "bitio.h"
+#include "dheap.h"
+#include <stdio.h>
+#include <string.h>
+
+/** Length header kinds, stored in its first byte */
+enum { LENGTHS_EMPTY, LENGTHS_SPARSE, LENGTHS_DENSE };
+/** Use the symbol list instead of the presence map up to this many symbols */
+#define SPARSE_LIMIT 30
+
+/**
+Builds a huffman tree by repeatedly combining the two least frequent nodes.
+The nodes live in the pool of the heap, so nothing needs to be freed. The
+nodes are ordered with a 4-ary heap of inline weights, so ties are broken by
+node index: leaves in symbol order, then internal nodes in creation order.
+Frequencies that add up to more than a heap key holds are all halved together
+until they fit, keeping every symbol that occurs, so the codes of such huge
+inputs are close to optimal rather than wrong.
+@param frequencies is the number of times each symbol appears
+@param alphabetSize is the number of entries in frequencies, up to MAX_LEAVES
+@param tree receives the tree: its only element is the root, or it is empty if
+no symbol appears
+*/
+void buildHuffmanTree(const uint64_t *frequencies, int alphabetSize,
+                      heap *tree) {
+  makenull(tree, alphabetSize);
+  heapItem storage[MAX_LEAVES];
+  dHeap queue;
+  initDHeap(&queue, storage, MAX_LEAVES);
+  /* The root weighs the sum of its leaves, each raised to 1 at most */
+  uint64_t total = 0;
+  for (int asciiValue = 0; asciiValue < tree->maxSize; asciiValue++) {
+    total += frequencies[asciiValue];
+  }
+  int shift = 0;
+  while ((total >> shift) > HEAP_MAX_WEIGHT - MAX_LEAVES) {
+    shift++;
+  }
+  for (int asciiValue = 0; asciiValue < tree->maxSize; asciiValue++) {
+    if (frequencies[asciiValue] == 0) {
+      continue;
+    }
+    uint64_t weight = frequencies[asciiValue] >> shift;
+    addItem(&queue, weight > 0 ? weight : 1,
+            createNode(tree, frequencies[asciiValue], asciiValue));
+  }
+  if (queue.size == 0) {
+    return;
+  }
+  heapify(&queue);
+  while (queue.size > 1) {
+    heapItem item01 = popItem(&queue);
+    heapItem item02 = queue.items[0];
+    int newNode = combineNodes(tree, itemIndex(item01), itemIndex(item02));
+    /* The parent takes the place of the second smallest node */
+    replaceTop(&queue, itemWeight(item01) + itemWeight(item02), newNode);
+  }
+  tree->data[0] = (uint16_t)itemIndex(queue.items[0]);
+  tree->currentSize = 1;
+}
+
+/**
+Recursively assigns the code of every leaf below a node
+@param tree is the heap whose pool holds the nodes
+@param index is the current node
+@param code is the path taken to reach the node, 0 for left and 1 for right
+@param depth is the number of bits in code
+@param table is the code table to fill
+@return the longest code length below the node
+*/
+static int assignCodes(const heap *tree, int index, uint32_t code, int depth,
+                       codeTable *table) {
+  const node *nodePtr = &tree->nodes[index];
+  if (nodePtr->leftChild == NO_CHILD) {
+    table->code[nodePtr->asciiValue] = code;
+    table->length[nodePtr->asciiValue] = depth > 255 ? 255 : (uint8_t)depth;
+    return depth;
+  }
+  int leftLength =
+      assignCodes(tree, nodePtr->leftChild, code << 1, depth + 1, table);
+  int rightLength =
+      assignCodes(tree, nodePtr->rightChild, (code << 1) | 1, depth + 1, table);
+  return leftLength > rightLength ? leftLength : rightLength;
+}
+
+/**
+Fills a code table from a huffman tree in a single traversal. A tree with a
+single leaf gets the one bit code 0 so that every symbol still takes up space
+in the stream. Codes deeper than MAX_CODE_LENGTH only keep their length.
+@param tree is the heap filled by buildHuffmanTree()
+@param table is the code table to fill
+@return the longest code length in the tree
+*/
+int buildCodeTable(const heap *tree, codeTable *table) {
+  memset(table, 0, sizeof(codeTable));
+  if (tree->currentSize == 0) {
+    return 0;
+  }
+  int root = tree->data[0];
+  int maxLength = assignCodes(tree, root, 0, 0, table);
+  if (maxLength == 0) {
+    /* Root is a leaf */
+    table->length[tree->nodes[root].asciiValue] = 1;
+    maxLength = 1;
+  }
+  return maxLength;
+}
+
+/**
+ This function prints the code of every symbol in a code table
+ @param table is the code table to print
+ @param frequencies is the number of times each symbol appears
+ @param alphabetSize is the number of symbols to print
+ */
+void printCodeTable(const codeTable *table, const uint64_t *frequencies,
+                    int alphabetSize) {
+  printf("| %5s | %s | %s |\n", "ASCII", "Percent", "Code");
+  printf("| ----- | ------- | ---- |\n");
+  char huffmanCode[MAX_CODE_LENGTH + 1];
+  for (int value = 0; value < alphabetSize; value++) {
+    int length = table->length[value];
+    if (length == 0) {
+      continue;
+    }
+    if (length > MAX_CODE_LENGTH) {
+      /* Only the length of such a code is kept */
+      snprintf(huffmanCode, sizeof(huffmanCode), "(%d bits)", length);
+    } else {
+      for (int i = 0; i < length; i++) {
+        huffmanCode[i] =
+            (table->code[value] >> (length - 1 - i)) & 1 ? '1' : '0';
+      }
+      huffmanCode[length] = '\0';
+    }
+    printf("| %5d | %1.5f | %s |\n", value, (double)frequencies[value] / 100,
+           huffmanCode);
+  }
+}
+
+/**
+qsort comparison for packed (frequency, symbol) keys
+@param a is the first key
+@param b is the second key
+@return negative, zero or positive as a is smaller, equal or larger
+*/
+static int compareKeys(const void *a, const void *b) {
+  uint64_t keyA = *(const uint64_t *)a;
+  uint64_t keyB = *(const uint64_t *)b;
+  return (keyA > keyB) - (keyA < keyB);
+}
+
+/**
+Sorts the used symbols by frequency
+@param frequencies is the number of times each symbol appears
+@param alphabetSize is the number of entries in frequencies
+@param keys receives one key per used symbol, in increasing order, with the
+frequency in the high bits and the symbol in the low byte so that ties are
+broken by symbol
+@return the number of used symbols
+*/
+static int sortSymbols(const uint64_t *frequencies, int alphabetSize,
+                       uint64_t *keys) {
+  int n = 0;
+  for (int symbol = 0; symbol < alphabetSize; symbol++) {
+    if (frequencies[symbol] != 0) {
+      uint64_t frequency = frequencies[symbol];
+      /* Saturate instead of losing the symbol byte; only matters past 2^56 */
+      frequency = frequency > (UINT64_MAX >> 8) ? UINT64_MAX >> 8 : frequency;
+      keys[n++] = frequency << 8 | (uint64_t)symbol;
+    }
+  }
+  qsort(keys, n, sizeof(uint64_t), compareKeys);
+  return n;
+}
+
+/**
+Computes optimal code lengths without building a tree. The used symbols are
+sorted by frequency once, then the Moffat-Katajainen method turns the sorted
+weights into parent pointers, node depths and finally leaf depths, reusing the
+same array each time. Needs no allocation and runs in linear time after the
+sort. A single used symbol gets length 1.
+@param frequencies is the number of times each symbol appears
+@param alphabetSize is the number of entries in frequencies
+@param table receives the lengths; codes are left for assignCanonicalCodes()
+@return the longest code length
+*/
+int computeCodeLengths(const uint64_t *frequencies, int alphabetSize,
+                       codeTable *table) {
+  memset(table, 0, sizeof(codeTable));
+  uint64_t keys[ALPHABET_SIZE];
+  int n = sortSymbols(frequencies, alphabetSize, keys);
+  if (n == 0) {
+    return 0;
+  }
+  if (n == 1) {
+    table->length[keys[0] & 0xFF] = 1;
+    return 1;
+  }
+  /* From here on the keys array holds the weights */
+  uint8_t symbols[ALPHABET_SIZE];
+  uint64_t *weight = keys;
+  for (int i = 0; i < n; i++) {
+    symbols[i] = (uint8_t)keys[i];
+    weight[i] = keys[i] >> 8;
+  }
+
+  /* First pass, left to right: weight[next] becomes the weight of the next
+   * internal node, and merged internal nodes store their parent's index */
+  int root = 0, leaf = 2;
+  weight[0] += weight[1];
+  for (int next = 1; next < n - 1; next++) {
+    if (leaf >= n || weight[root] < weight[leaf]) {
+      weight[next] = weight[root];
+      weight[root++] = next;
+    } else {
+      weight[next] = weight[leaf++];
+    }
+    if (leaf >= n || (root < next && weight[root] < weight[leaf])) {
+      weight[next] += weight[root];
+      weight[root++] = next;
+    } else {
+      weight[next] += weight[leaf++];
+    }
+  }
+  /* Second pass, right to left: parent pointers become internal depths */
+  weight[n - 2] = 0;
+  for (int next = n - 3; next >= 0; next--) {
+    weight[next] = weight[weight[next]] + 1;
+  }
+  /* Third pass, right to left: internal depths become leaf depths */
+  int available = 1, used = 0, depth = 0, next = n - 1;
+  root = n - 2;
+  while (available > 0) {
+    while (root >= 0 && (int)weight[root] == depth) {
+      used++;
+      root--;
+    }
+    while (available > used) {
+      weight[next--] = depth;
+      available--;
+    }
+    available = 2 * used;
+    depth++;
+    used = 0;
+  }
+
+  int maxLength = 0;
+  for (int i = 0; i < n; i++) {
+    int length = (int)weight[i];
+    table->length[symbols[i]] = length > 255 ? 255 : (uint8_t)length;
+    maxLength = length > maxLength ? length : maxLength;
+  }
+  return maxLength;
+}
+
+/**
+Computes optimal code lengths that do not exceed a limit, using the package
+merge method. Level 1 lists the symbols by weight; every higher level merges the
+symbols with pairs ("packages") of the level below. Taking the 2n - 2 cheapest
+items of the top level and expanding packages back down, a symbol's length is
+the number of levels it gets picked at.
+@param frequencies is the number of times each symbol appears
+@param alphabetSize is the number of entries in frequencies
+@param maxLength is the longest allowed code, at most MAX_CODE_LENGTH
+@param table receives the lengths; codes are left for assignCanonicalCodes()
+@return the longest code length, or -1 if maxLength bits cannot give every used
+symbol a code
+*/
+int limitCodeLengths(const uint64_t *frequencies, int alphabetSize,
+                     int maxLength, codeTable *table) {
+  memset(table, 0, sizeof(codeTable));
+  uint64_t keys[ALPHABET_SIZE];
+  int n = sortSymbols(frequencies, alphabetSize, keys);
+  if (n == 0) {
+    return 0;
+  }
+  if (maxLength > MAX_CODE_LENGTH || n > (1LL << maxLength)) {
+    return -1;
+  }
+  if (n == 1) {
+    table->length[keys[0] & 0xFF] = 1;
+    return 1;
+  }
+  /* Only whether each item is a symbol needs to be kept for every level; the
+   * weights are rolled between two buffers */
+  bool isSymbol[MAX_CODE_LENGTH][2 * ALPHABET_SIZE];
+  int listSize[MAX_CODE_LENGTH];
+  uint64_t weights[2][2 * ALPHABET_SIZE];
+  for (int i = 0; i < n; i++) {
+    weights[0][i] = keys[i] >> 8;
+    isSymbol[0][i] = true;
+  }
+  listSize[0] = n;
+  for (int level = 1; level < maxLength; level++) {
+    const uint64_t *below = weights[(level - 1) & 1];
+    uint64_t *list = weights[level & 1];
+    int packages = listSize[level - 1] / 2;
+    int symbol = 0, package = 0, size = 0;
+    while (symbol < n || package < packages) {
+      uint64_t packageWeight = package < packages
+                                   ? below[2 * package] + below[2 * package + 1]
+                                   : UINT64_MAX;
+      if (symbol < n && (keys[symbol] >> 8) <= packageWeight) {
+        list[size] = keys[symbol++] >> 8;
+        isSymbol[level][size++] = true;
+      } else {
+        list[size] = packageWeight;
+        isSymbol[level][size++] = false;
+        package++;
+      }
+    }
+    listSize[level] = size;
+  }
+  /* Select the cheapest items from the top down. The symbols among the first
+   * picked items of a level are always the lightest ones. */
+  int picked = 2 * n - 2;
+  for (int level = maxLength - 1; level >= 0 && picked > 0; level--) {
+    int symbols = 0;
+    for (int i = 0; i < picked; i++) {
+      symbols += isSymbol[level][i];
+    }
+    for (int i = 0; i < symbols; i++) {
+      table->length[keys[i] & 0xFF]++;
+    }
+    picked = 2 * (picked - symbols);
+  }
+  int longest = 0;
+  for (int i = 0; i < n; i++) {
+    int length = table->length[keys[i] & 0xFF];
+    longest = length > longest ? length : longest;
+  }
+  return longest;
+}
+
+/**
+Number of bits a code table spends on the payload
+@param table is the code table
+@param frequencies is the number of times each symbol appears
+@return sum of frequency times code length over all symbols
+*/
+uint64_t encodedBits(const codeTable *table, const uint64_t *frequencies) {
+  uint64_t bits = 0;
+  for (int symbol = 0; symbol < ALPHABET_SIZE; symbol++) {
+    bits += frequencies[symbol] * table->length[symbol];
+  }
+  return bits;
+}
+
+/**
+Replaces the codes in a table with canonical codes for the same lengths.
+Shorter codes come first and codes of equal length are in symbol order.
+@param table is the code table whose lengths are used and codes are replaced
+@return 0 on success, -1 if the lengths cannot form a prefix code
+*/
+int assignCanonicalCodes(codeTable *table) {
+  int lengthCount[MAX_CODE_LENGTH + 1] = {0};
+  for (int symbol = 0; symbol < ALPHABET_SIZE; symbol++) {
+    if (table->length[symbol] > MAX_CODE_LENGTH) {
+      return -1;
+    }
+    lengthCount[table->length[symbol]]++;
+  }
+  /* nextCode[length] is the first code of that length */
+  uint64_t nextCode[MAX_CODE_LENGTH + 1];
+  uint64_t code = 0;
+  lengthCount[0] = 0;
+  for (int length = 1; length <= MAX_CODE_LENGTH; length++) {
+    code = (code + lengthCount[length - 1]) << 1;
+    nextCode[length] = code;
+    /* Kraft inequality: codes of this length must fit in length bits */
+    if (code + lengthCount[length] > (1ULL << length)) {
+      return -1;
+    }
+  }
+  for (int symbol = 0; symbol < ALPHABET_SIZE; symbol++) {
+    int length = table->length[symbol];
+    table->code[symbol] = length ? (uint32_t)nextCode[length]++ : 0;
+  }
+  return 0;
+}
+
+/**
+Writes the code lengths of a table in compact form. Lists symbols explicitly
+when few are used and a 256 bit presence map otherwise, followed by 5 bits per
+used symbol.
+@param table is the code table to describe
+@param out receives at most MAX_LENGTHS_SIZE bytes
+@return number of bytes written
+*/
+size_t writeCodeLengths(const codeTable *table, uint8_t *out) {
+  int symbolCount = 0;
+  for (int symbol = 0; symbol < ALPHABET_SIZE; symbol++) {
+    symbolCount += table->length[symbol] != 0;
+  }
+  uint8_t *ptr = out;
+  if (symbolCount == 0) {
+    *ptr++ = LENGTHS_EMPTY;
+    return 1;
+  }
+  if (symbolCount <= SPARSE_LIMIT) {
+    *ptr++ = LENGTHS_SPARSE;
+    *ptr++ = (uint8_t)(symbolCount - 1);
+    for (int symbol = 0; symbol < ALPHABET_SIZE; symbol++) {
+      if (table->length[symbol] != 0) {
+        *ptr++ = (uint8_t)symbol;
+      }
+    }
+  } else {
+    *ptr++ = LENGTHS_DENSE;
+    memset(ptr, 0, ALPHABET_SIZE / 8);
+    for (int symbol = 0; symbol < ALPHABET_SIZE; symbol++) {
+      if (table->length[symbol] != 0) {
+        ptr[symbol / 8] |= (uint8_t)(1 << (symbol % 8));
+      }
+    }
+    ptr += ALPHABET_SIZE / 8;
+  }
+  /* Lengths are 1 to 32, stored as length - 1 */
+  bitWriter writer;
+  bitWriterInit(&writer, ptr);
+  for (int symbol = 0; symbol < ALPHABET_SIZE; symbol++) {
+    if (table->length[symbol] != 0) {
+      putBits(&writer, table->length[symbol] - 1, 5);
+    }
+  }
+  ptr += finishBits(&writer);
+  return (size_t)(ptr - out);
+}
+
+/**
+Size of the code lengths of a table with a given number of used symbols,
+which does not depend on the lengths themselves
+@param symbolCount is the number of symbols with a code
+@return number of bytes writeCodeLengths() writes for such a table
+*/
+size_t codeLengthsSize(int symbolCount) {
+  if (symbolCount == 0) {
+    return 1;
+  }
+  size_t listSize = symbolCount <= SPARSE_LIMIT ? 2 + (size_t)symbolCount
+                                                : 1 + ALPHABET_SIZE / 8;
+  return listSize + (5 * (size_t)symbolCount + 7) / 8;
+}
+
+/**
+Reads code lengths written by writeCodeLengths() and assigns canonical codes
+@param in is the start of the code lengths
+@param size is the number of bytes available
+@param table is the code table to fill
+@return number of bytes read, or 0 if the data is corrupt
+*/
+size_t readCodeLengths(const uint8_t *in, size_t size, codeTable *table) {
+  memset(table, 0, sizeof(codeTable));
+  if (size < 1) {
+    return 0;
+  }
+  const uint8_t *ptr = in + 1;
+  const uint8_t *end = in + size;
+  uint8_t symbols[ALPHABET_SIZE];
+  int symbolCount = 0;
+  if (in[0] == LENGTHS_EMPTY) {
+    return 1;
+  } else if (in[0] == LENGTHS_SPARSE) {
+    if (end - ptr < 1 || end - ptr < 1 + ptr[0] + 1) {
+      return 0;
+    }
+    symbolCount = ptr[0] + 1;
+    memcpy(symbols, ptr + 1, symbolCount);
+    ptr += 1 + symbolCount;
+  } else if (in[0] == LENGTHS_DENSE) {
+    if (end - ptr < ALPHABET_SIZE / 8) {
+      return 0;
+    }
+    for (int symbol = 0; symbol < ALPHABET_SIZE; symbol++) {
+      if (ptr[symbol / 8] & (1 << (symbol % 8))) {
+        symbols[symbolCount++] = (uint8_t)symbol;
+      }
+    }
+    ptr += ALPHABET_SIZE / 8;
+  } else {
+    return 0;
+  }
+  size_t lengthBytes = ((size_t)symbolCount * 5 + 7) / 8;
+  if (symbolCount == 0 || (size_t)(end - ptr) < lengthBytes) {
+    return 0;
+  }
+  bitReader reader;
+  bitReaderInit(&reader, ptr, lengthBytes);
+  for (int i = 0; i < symbolCount; i++) {
+    refillBits(&reader);
+    if (table->length[symbols[i]] != 0) {
+      /* Symbol listed twice */
+      return 0;
+    }
+    table->length[symbols[i]] = (uint8_t)(peekBits(&reader, 5) + 1);
+    skipBits(&reader, 5);
+  }
+  if (assignCanonicalCodes(table) < 0) {
+    return 0;
+  }
+  return (size_t)(ptr + lengthBytes - in);
+}
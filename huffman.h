@@ -0,0 +1,142 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file contains the interface for turning symbol frequencies into
+        a huffman tree and the tree into a table of binary codes that an
+        encoder can use directly. Codes are canonical: they only depend on
+        the code lengths, so the lengths are all a decoder needs.
+
+*/
+
+#ifndef _HUFFMAN_H_
+#define _HUFFMAN_H_
+
+#include "heap.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/** Number of symbols in a byte alphabet */
+#define ALPHABET_SIZE 256
+/** Longest code the bit writer and the file format can carry */
+#define MAX_CODE_LENGTH 32
+/** Largest number of bytes writeCodeLengths() can produce */
+#define MAX_LENGTHS_SIZE (1 + ALPHABET_SIZE / 8 + ALPHABET_SIZE * 5 / 8 + 4)
+
+/**
+Flat symbol to code mapping. Codes are right aligned and are written most
+significant bit first. A length of 0 means the symbol does not occur.
+*/
+typedef struct CodeTable {
+  uint32_t code[ALPHABET_SIZE]; /**< Code bits for each symbol */
+  uint8_t length[ALPHABET_SIZE]; /**< Code length in bits for each symbol */
+} codeTable;
+
+/**
+Builds a huffman tree by repeatedly combining the two least frequent nodes.
+The nodes live in the pool of the heap, so nothing needs to be freed. The
+nodes are ordered with a 4-ary heap of inline weights, so ties are broken by
+node index: leaves in symbol order, then internal nodes in creation order.
+Frequencies that add up to more than a heap key holds are all halved together
+until they fit, keeping every symbol that occurs, so the codes of such huge
+inputs are close to optimal rather than wrong.
+@param frequencies is the number of times each symbol appears
+@param alphabetSize is the number of entries in frequencies, up to MAX_LEAVES
+@param tree receives the tree: its only element is the root, or it is empty if
+no symbol appears
+*/
+void buildHuffmanTree(const uint64_t *frequencies, int alphabetSize,
+                      heap *tree);
+
+/**
+Fills a code table from a huffman tree in a single traversal. A tree with a
+single leaf gets the one bit code 0 so that every symbol still takes up space
+in the stream. Codes deeper than MAX_CODE_LENGTH only keep their length.
+@param tree is the heap filled by buildHuffmanTree()
+@param table is the code table to fill
+@return the longest code length in the tree
+*/
+int buildCodeTable(const heap *tree, codeTable *table);
+
+/**
+ This function prints the code of every symbol in a code table
+ @param table is the code table to print
+ @param frequencies is the number of times each symbol appears
+ @param alphabetSize is the number of symbols to print
+ */
+void printCodeTable(const codeTable *table, const uint64_t *frequencies,
+                    int alphabetSize);
+
+/**
+Computes optimal code lengths without building a tree. The used symbols are
+sorted by frequency once, then the Moffat-Katajainen method turns the sorted
+weights into parent pointers, node depths and finally leaf depths, reusing the
+same array each time. Needs no allocation and runs in linear time after the
+sort. A single used symbol gets length 1.
+@param frequencies is the number of times each symbol appears
+@param alphabetSize is the number of entries in frequencies
+@param table receives the lengths; codes are left for assignCanonicalCodes()
+@return the longest code length
+*/
+int computeCodeLengths(const uint64_t *frequencies, int alphabetSize,
+                       codeTable *table);
+
+/**
+Computes optimal code lengths that do not exceed a limit, using the package
+merge method. Costs O(n * maxLength) time but needs no tree.
+@param frequencies is the number of times each symbol appears
+@param alphabetSize is the number of entries in frequencies
+@param maxLength is the longest allowed code, at most MAX_CODE_LENGTH
+@param table receives the lengths; codes are left for assignCanonicalCodes()
+@return the longest code length, or -1 if maxLength bits cannot give every used
+symbol a code
+*/
+int limitCodeLengths(const uint64_t *frequencies, int alphabetSize,
+                     int maxLength, codeTable *table);
+
+/**
+Number of bits a code table spends on the payload
+@param table is the code table
+@param frequencies is the number of times each symbol appears
+@return sum of frequency times code length over all symbols
+*/
+uint64_t encodedBits(const codeTable *table, const uint64_t *frequencies);
+
+/**
+Replaces the codes in a table with canonical codes for the same lengths.
+Shorter codes come first and codes of equal length are in symbol order.
+@param table is the code table whose lengths are used and codes are replaced
+@return 0 on success, -1 if the lengths cannot form a prefix code
+*/
+int assignCanonicalCodes(codeTable *table);
+
+/**
+Writes the code lengths of a table in compact form. Lists symbols explicitly
+when few are used and a 256 bit presence map otherwise, followed by 5 bits per
+used symbol.
+@param table is the code table to describe
+@param out receives at most MAX_LENGTHS_SIZE bytes
+@return number of bytes written
+*/
+size_t writeCodeLengths(const codeTable *table, uint8_t *out);
+
+/**
+Size of the code lengths of a table with a given number of used symbols,
+which does not depend on the lengths themselves
+@param symbolCount is the number of symbols with a code
+@return number of bytes writeCodeLengths() writes for such a table
+*/
+size_t codeLengthsSize(int symbolCount);
+
+/**
+Reads code lengths written by writeCodeLengths() and assigns canonical codes
+@param in is the start of the code lengths
+@param size is the number of bytes available
+@param table is the code table to fill
+@return number of bytes read, or 0 if the data is corrupt
+*/
+size_t readCodeLengths(const uint8_t *in, size_t size, codeTable *table);
+
+#endif
@@ -0,0 +1,138 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file implements memory mapped inputs with a buffered read
+        fallback for streams that cannot be mapped.
+
+ */
+#include "input.h"
+#include "stats.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** First buffer size when reading a stream, doubled as needed */
+#define INITIAL_READ_SIZE (1 << 20)
+
+/**
+Reads a file descriptor until end of file
+@param fd is the descriptor to read
+@param input receives the contents
+@return 0 on success, -1 on failure
+*/
+static int readStream(int fd, inputSource *input) {
+  size_t capacity = INITIAL_READ_SIZE;
+  size_t size = 0;
+  uint8_t *data = malloc(capacity);
+  while (data != NULL) {
+    if (size == capacity) {
+      capacity *= 2;
+      uint8_t *grown = realloc(data, capacity);
+      if (grown == NULL) {
+        break;
+      }
+      data = grown;
+    }
+    ssize_t nbytes = read(fd, data + size, capacity - size);
+    if (nbytes == 0) {
+      input->data = data;
+      input->size = size;
+      input->mapped = 0;
+      return 0;
+    }
+    if (nbytes < 0) {
+      break;
+    }
+    size += (size_t)nbytes;
+  }
+  free(data);
+  return -1;
+}
+
+/**
+Opens an input. Regular files are mapped with sequential read-ahead advice,
+anything else (or "-" for standard input) is read until end of file.
+@param path is the file to open
+@param input receives the contents
+@return 0 on success, -1 on failure with a message printed to stderr
+*/
+int openInput(const char *path, inputSource *input) {
+  uint64_t start = startPhase();
+  int fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY);
+  if (fd < 0) {
+    perror(path);
+    return -1;
+  }
+  struct stat info;
+  int status = -1;
+  if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+    input->size = (size_t)info.st_size;
+    input->mapped = 1;
+    if (input->size == 0) {
+      /* mmap() rejects empty mappings */
+      input->data = NULL;
+      status = 0;
+    } else {
+      void *data = mmap(NULL, input->size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data != MAP_FAILED) {
+        madvise(data, input->size, MADV_SEQUENTIAL);
+        input->data = data;
+        status = 0;
+      }
+    }
+  }
+  if (status < 0) {
+    status = readStream(fd, input);
+  }
+  if (status < 0) {
+    perror(path);
+  }
+  if (fd != STDIN_FILENO) {
+    close(fd);
+  }
+  endPhase(PHASE_READ, start);
+  return status;
+}
+
+/**
+Asks the kernel to start reading part of a mapped input in the background, so
+that its pages are in memory by the time they are scanned. A buffered input is
+already in memory.
+@param input is the input
+@param offset is the first byte of the part
+@param length is the number of bytes, clipped to the end of the input
+*/
+void prefetchInput(const inputSource *input, size_t offset, size_t length) {
+  if (!input->mapped || offset >= input->size) {
+    return;
+  }
+  if (length > input->size - offset) {
+    length = input->size - offset;
+  }
+  /* madvise() takes a page aligned start */
+  uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+  uintptr_t start = (uintptr_t)(input->data + offset) & ~(page - 1);
+  uintptr_t end = (uintptr_t)(input->data + offset + length);
+  madvise((void *)start, end - start, MADV_WILLNEED);
+}
+
+/**
+Releases an input opened with openInput()
+@param input is the input to release
+*/
+void closeInput(inputSource *input) {
+  if (input->mapped && input->size > 0) {
+    munmap((void *)input->data, input->size);
+  } else if (!input->mapped) {
+    free((void *)input->data);
+  }
+  input->data = NULL;
+  input->size = 0;
+}
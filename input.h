@@ -0,0 +1,54 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file contains the interface for reading a whole input into
+        memory. Regular files are memory mapped so that every pass over the
+        data reads the page cache directly; pipes and other streams are
+        read into a buffer instead.
+
+*/
+
+#ifndef _INPUT_H_
+#define _INPUT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+An input that can be scanned any number of times
+*/
+typedef struct InputSource {
+  const uint8_t *data; /**< Contents of the input */
+  size_t size;         /**< Number of bytes in data */
+  int mapped;          /**< 1 if data is a mapping, 0 if it was malloc'd */
+} inputSource;
+
+/**
+Opens an input. Regular files are mapped with sequential read-ahead advice,
+anything else (or "-" for standard input) is read until end of file.
+@param path is the file to open
+@param input receives the contents
+@return 0 on success, -1 on failure with a message printed to stderr
+*/
+int openInput(const char *path, inputSource *input);
+
+/**
+Asks the kernel to start reading part of a mapped input in the background, so
+that its pages are in memory by the time they are scanned. A buffered input is
+already in memory.
+@param input is the input
+@param offset is the first byte of the part
+@param length is the number of bytes, clipped to the end of the input
+*/
+void prefetchInput(const inputSource *input, size_t offset, size_t length);
+
+/**
+Releases an input opened with openInput()
+@param input is the input to release
+*/
+void closeInput(inputSource *input);
+
+#endif
@@ -12,57 +12,471 @@
 
         This program uses the properties of min_heap to implement
         a Huffman data compression algorithm. Takes a file as input and
-        calculates the frequencies for each ASCII character [0,127],
-        then encodes it into mod 2 form.
+        calculates the frequencies for each ASCII character [0,127]
+        (or every byte value [0,255]), then encodes it into mod 2 form.
+
+        Usage:
+          ./main                     prompt for a file and print its codes
+          ./main file                print the codes of file
+          ./main -a file             same, for all 256 byte values
+          ./main -c input output     compress input into output
+          ./main -c -H input output  same, building codes with the heap
+          ./main -c -L 11 in out     same, with codes of at most 11 bits
+          ./main -c -B 128K -j 4 ... same, 128 KiB blocks on 4 threads
+          ./main -c -s 4 in out      same, 4 interleaved streams per block
+          ./main -c -O 1 in out      same, a code table per preceding byte
+          ./main -d input output     decompress input into output
+          ./main -d -r 1M:4K in out  decompress only 4 KiB from offset 1 MiB
+          ./main -c -A - out         compress a pipe with adaptive codes
+          ./main -d -A in -          decompress an adaptive stream to stdout
+          ./main -T t.hut samples... train a shared table on sample files
+          ./main -c -t t.hut in out  compress a small input into a record
+          ./main -d -t t.hut in out  decompress a record
+          ./main -c -b files...      compress each file into file.huf
+          ./main -c -b -o a.hua -m list  compress the files listed in list
+                                     into one archive
+          ./main -d -b files...      decompress .huf files and archives
+          ./main -c --stats in out   same as -c, then print phase times and
+                                     counters as JSON on stderr
  */
 
+#include "adaptive.h"
+#include "batch.h"
+#include "decoder.h"
+#include "encoder.h"
 #include "heap.h"
+#include "histogram.h"
+#include "huffman.h"
+#include "shared.h"
+#include "stats.h"
+#include <getopt.h>
+#include <inttypes.h>
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
 #define MAX_SIZE 128
+/** Bytes read from the file at a time */
+#define READ_SIZE (1 << 20)
 
 /**
 Huffman algorithm which constructs a huffman tree and prints it
 @param fileName is the file to open and construct a huffman tree off of
+@param alphabetSize is MAX_SIZE to only consider ASCII characters, or
+ALPHABET_SIZE for every byte value
 */
-void huffman(char *fileName) {
+void huffman(char *fileName, int alphabetSize) {
   FILE *file;
 
-  file = fopen(fileName, "r");
+  file = fopen(fileName, "rb");
+  if (file == NULL) {
+    perror(fileName);
+    exit(EXIT_FAILURE);
+  }
   /* We'll use an array, which acts sort of like a dictionary
-   * The index is the ASCII character, and the value is the number of times it
-   * appears in the text file. We know that ASCII chars range from 0-127, so the
-   * max size is 128
+   * The index is the byte value, and the value is the number of times it
+   * appears in the file. Every byte is counted; in ASCII mode only the first
+   * MAX_SIZE entries are used.
    */
-  int frequencyArray[MAX_SIZE] = {0};
-  /* Implicit conversion from char to ASCII code */
-  int index;
-  /* Use total chars to calculate number of bits later */
-  int totalChars = 0;
-  while ((index = fgetc(file)) != EOF) {
-    totalChars += index >= 0 && index <= 127 ? frequencyArray[index]++ : 0;
+  uint64_t frequencyArray[ALPHABET_SIZE] = {0};
+  uint8_t *buffer = malloc(READ_SIZE);
+  size_t nbytes;
+  uint64_t start = startPhase();
+  while ((nbytes = fread(buffer, 1, READ_SIZE, file)) > 0) {
+    endPhase(PHASE_READ, start);
+    countStat(COUNTER_BYTES_IN, nbytes);
+    countBytes(buffer, nbytes, frequencyArray);
+    start = startPhase();
   }
+  free(buffer);
   fclose(file);
-  heap *heap = makenull(MAX_SIZE);
-  for (int asciiValue = 0; asciiValue < MAX_SIZE; asciiValue++) {
-    if (frequencyArray[asciiValue] == 0) {
-      continue;
-    }
-    insert((double)frequencyArray[asciiValue] / 100, asciiValue, heap);
+  heap tree;
+  start = startPhase();
+  buildHuffmanTree(frequencyArray, alphabetSize, &tree);
+  endPhase(PHASE_TREE, start);
+  codeTable table;
+  start = startPhase();
+  buildCodeTable(&tree, &table);
+  endPhase(PHASE_CODES, start);
+  start = startPhase();
+  printCodeTable(&table, frequencyArray, alphabetSize);
+  endPhase(PHASE_PRINT, start);
+}
+
+/**
+Prints the outcome of a compression or decompression run
+@param stream is where to print, stderr when the output went to stdout
+@param verb describes what was done
+@param path is the input file
+@param result holds the sizes and time taken
+@param rawBytes is the uncompressed size that throughput is measured against
+*/
+void printResult(FILE *stream, const char *verb, const char *path,
+                 codingResult *result, uint64_t rawBytes) {
+  fprintf(stream,
+          "%s %s: %" PRIu64 " -> %" PRIu64 " bytes (%.2f%%) in %.3f s, "
+          "%.1f MB/s\n",
+          verb, path, result->inputBytes, result->outputBytes,
+          result->inputBytes ? 100.0 * result->outputBytes / result->inputBytes
+                             : 0.0,
+          result->seconds,
+          result->seconds > 0 ? rawBytes / 1e6 / result->seconds : 0.0);
+}
+
+/**
+Parses a byte count with an optional K or M suffix
+@param text is the count, for example 131072, 128K or 1M
+@param end receives the first character after the count
+@return the number of bytes
+*/
+uint64_t parseCount(const char *text, char **end) {
+  uint64_t count = strtoull(text, end, 10);
+  if (**end == 'K' || **end == 'k') {
+    count <<= 10;
+    (*end)++;
+  } else if (**end == 'M' || **end == 'm') {
+    count <<= 20;
+    (*end)++;
   }
-  while (heap->currentSize != 1) {
-    node *node01 = extractMin(heap);
-    node *node02 = extractMin(heap);
-    node *newNode = combineNodes(node01, node02);
-    insertNode(newNode, heap);
+  return count;
+}
+
+/**
+Parses a byte count with an optional K or M suffix
+@param text is the count, for example 131072, 128K or 1M
+@return the number of bytes, or 0 if text is not a valid count
+*/
+int parseSize(const char *text) {
+  char *end;
+  uint64_t size = parseCount(text, &end);
+  return *end == '\0' && size > 0 && size <= INT32_MAX ? (int)size : 0;
+}
+
+/**
+Parses a byte range written as offset:length, both with optional K or M
+suffixes
+@param text is the range, for example 1M:4K
+@param offset receives the first byte of the range
+@param length receives the number of bytes in the range
+@return 0 on success, -1 if text is not a valid range
+*/
+int parseRange(const char *text, uint64_t *offset, uint64_t *length) {
+  char *end;
+  *offset = parseCount(text, &end);
+  if (end == text || *end != ':') {
+    return -1;
   }
-  printHuffman(heap);
-  deleteHuffman(heap);
+  text = end + 1;
+  *length = parseCount(text, &end);
+  return end != text && *end == '\0' ? 0 : -1;
 }
 
-int main() {
+/**
+Codes the files named on the command line and in a manifest in one batch
+@param mode is 'c' to compress or 'd' to decompress
+@param files is the files named on the command line
+@param count is the number of files
+@param manifest is a list of more files, or NULL
+@param archive is the archive to compress into, or NULL
+@param options are the encoder settings
+@param decodeOptions are the decoder settings
+@return the exit status
+*/
+int runBatch(int mode, char **files, int count, const char *manifest,
+             const char *archive, const encoderOptions *options,
+             const decoderOptions *decodeOptions) {
+  char **listed = NULL;
+  int listedCount = 0;
+  if (manifest != NULL && readManifest(manifest, &listed, &listedCount) < 0) {
+    return EXIT_FAILURE;
+  }
+  char **paths = malloc(sizeof(char *) * (count + listedCount + 1));
+  for (int i = 0; i < count; i++) {
+    paths[i] = files[i];
+  }
+  for (int i = 0; i < listedCount; i++) {
+    paths[count + i] = listed[i];
+  }
+  batchResult result;
+  int status;
+  char what[32];
+  if (mode == 'c') {
+    status = compressBatch(paths, count + listedCount, options, archive,
+                           &result);
+    snprintf(what, sizeof(what), "%d files", result.files);
+    printResult(stdout, "Compressed", what, &result.total,
+                result.total.inputBytes);
+  } else {
+    status = decompressBatch(paths, count + listedCount, decodeOptions,
+                             &result);
+    snprintf(what, sizeof(what), "%d files", result.files);
+    printResult(stdout, "Decompressed", what, &result.total,
+                result.total.outputBytes);
+  }
+  if (result.failed > 0) {
+    fprintf(stderr, "%d files failed\n", result.failed);
+  }
+  for (int i = 0; i < listedCount; i++) {
+    free(listed[i]);
+  }
+  free(listed);
+  free(paths);
+  return status < 0 ? EXIT_FAILURE : 0;
+}
+
+/** File the --stats report goes to, "-" for standard error, or NULL */
+static const char *statsPath = NULL;
+/** What the run does, for the --stats report */
+static const char *statsCommand = "print";
+
+/**
+Writes the --stats report when the program exits, however it exits
+*/
+void reportStats(void) {
+  FILE *out = strcmp(statsPath, "-") == 0 ? stderr : fopen(statsPath, "w");
+  if (out == NULL || writeStats(out, statsCommand) < 0) {
+    perror(statsPath);
+  }
+  if (out != NULL && out != stderr) {
+    fclose(out);
+  }
+}
+
+/**
+Prints how to run the program and exits
+*/
+void usage(void) {
+  printf("Usage: ./main [-a] [file]\n"
+         "       ./main -c [-H] [-L bits] [-B size] [-j threads] [-s streams]\n"
+         "                [-O order] input output\n"
+         "       ./main -d [-j threads] [-r offset:length] input output\n"
+         "       ./main -c -A input output, ./main -d -A input output\n"
+         "       ./main -T table [-L bits] samples...\n"
+         "       ./main -c -t table input output, ./main -d -t table... input "
+         "output\n"
+         "       ./main -c -b [-o archive] [-m list] [options] files...\n"
+         "       ./main -d -b [-j threads] [-m list] files...\n"
+         "  -a  print codes for all 256 byte values, not just ASCII\n"
+         "  -A  adaptive huffman codes in one pass, for pipes and streams; "
+         "output\n"
+         "      may be - for standard output\n"
+         "  -b  code many files at once, one per worker thread; each is "
+         "written next\n"
+         "      to itself with .huf added, or without it when decompressing\n"
+         "  -c  compress input into output\n"
+         "  -d  decompress input into output\n"
+         "  -H  build codes with the min heap instead of in place\n"
+         "  -m  also code the files listed in this file, one per line (- "
+         "for stdin)\n"
+         "  -o  with -c -b, write one archive instead of a file per input\n"
+         "  -L  limit codes to at most this many bits (default 32)\n"
+         "  -B  bytes per block, with an optional K or M suffix (default "
+         "1M)\n"
+         "  -j  number of worker threads (default: one per processor)\n"
+         "  -O  1 codes each byte with a table chosen by the byte before it "
+         "(default 0)\n"
+         "  -r  only decompress this byte range of the original, decoding "
+         "just the\n"
+         "      blocks that cover it\n"
+         "  -s  split each block into this many streams, 4 decodes fastest "
+         "(default 1);\n"
+         "      not with -O 1, whose blocks are one stream\n"
+         "  -t  code a record with this shared table; repeat to decode "
+         "records made\n"
+         "      with any of several tables\n"
+         "  -T  train a shared table on the sample files and save it\n"
+         "  --stats[=file]  time each phase and count the work done, and "
+         "write them\n"
+         "      as JSON to file or standard error on exit\n");
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv) {
+  encoderOptions options;
+  defaultEncoderOptions(&options);
+  decoderOptions decodeOptions;
+  defaultDecoderOptions(&decodeOptions);
+  int mode = 0;
+  int extract = 0;
+  int adaptive = 0;
+  int batch = 0;
+  const char *manifest = NULL, *archive = NULL;
+  uint64_t rangeOffset = 0, rangeLength = 0;
+  const char *trainPath = NULL;
+  static tableRegistry registry;
+  int alphabetSize = MAX_SIZE;
+  static const struct option longOptions[] = {
+      {"stats", optional_argument, NULL, 'S'},
+      {NULL, 0, NULL, 0},
+  };
+  int opt;
+  while ((opt = getopt_long(argc, argv, "aAbcdHL:B:j:m:o:O:r:s:t:T:",
+                            longOptions, NULL)) != -1) {
+    switch (opt) {
+    case 'a':
+      alphabetSize = ALPHABET_SIZE;
+      break;
+    case 'A':
+      adaptive = 1;
+      break;
+    case 'b':
+      batch = 1;
+      break;
+    case 'c':
+    case 'd':
+      mode = opt;
+      break;
+    case 'H':
+      options.builder = BUILD_HEAP;
+      break;
+    case 'L':
+      options.maxCodeLength = (int)strtol(optarg, NULL, 10);
+      break;
+    case 'B':
+      options.blockSize = parseSize(optarg);
+      break;
+    case 'j':
+      options.threads = (int)strtol(optarg, NULL, 10);
+      decodeOptions.threads = options.threads;
+      break;
+    case 'm':
+      manifest = optarg;
+      break;
+    case 'o':
+      archive = optarg;
+      break;
+    case 'O':
+      options.contextOrder = (int)strtol(optarg, NULL, 10);
+      break;
+    case 'r':
+      if (parseRange(optarg, &rangeOffset, &rangeLength) < 0) {
+        usage();
+      }
+      extract = 1;
+      break;
+    case 's':
+      options.streams = (int)strtol(optarg, NULL, 10);
+      break;
+    case 't':
+      if (loadTable(optarg, &registry) < 0) {
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'T':
+      trainPath = optarg;
+      break;
+    case 'S':
+      statsPath = optarg != NULL ? optarg : "-";
+      break;
+    default:
+      usage();
+    }
+  }
+  argc -= optind;
+  argv += optind;
+  if (options.contextOrder == 1 && options.streams > 1) {
+    usage();
+  }
+  if (statsPath != NULL) {
+    if (trainPath != NULL && mode == 0) {
+      statsCommand = "train";
+    } else if (mode == 'c') {
+      statsCommand = "compress";
+    } else if (mode == 'd') {
+      statsCommand = extract ? "extract" : "decompress";
+    }
+    enableStats();
+    atexit(reportStats);
+  }
+  codingResult result;
+  if (trainPath != NULL && mode == 0 && argc > 0) {
+    sharedTable *table = &registry.tables[0];
+    if (trainTable(argv, argc, options.maxCodeLength, table) < 0 ||
+        saveTable(trainPath, table) < 0) {
+      exit(EXIT_FAILURE);
+    }
+    printf("Trained table %08" PRIx32 " on %d files into %s\n", table->id,
+           argc, trainPath);
+    return 0;
+  }
+  if (mode != 0 && batch) {
+    return runBatch(mode, argv, argc, manifest, archive, &options,
+                    &decodeOptions);
+  }
+  if (mode != 0 && registry.count > 0 && argc == 2) {
+    if (mode == 'c') {
+      if (compressRecord(argv[0], argv[1], &registry.tables[0], &result) <
+          0) {
+        exit(EXIT_FAILURE);
+      }
+      printResult(stdout, "Compressed", argv[0], &result, result.inputBytes);
+    } else {
+      if (decompressRecord(argv[0], argv[1], &registry, &result) < 0) {
+        exit(EXIT_FAILURE);
+      }
+      printResult(stdout, "Decompressed", argv[0], &result,
+                  result.outputBytes);
+    }
+    return 0;
+  }
+  if (mode != 0 && adaptive && argc == 2) {
+    /* The output may be standard output, so report on standard error */
+    FILE *report = strcmp(argv[1], "-") == 0 ? stderr : stdout;
+    if (mode == 'c') {
+      if (compressStream(argv[0], argv[1], &result) < 0) {
+        exit(EXIT_FAILURE);
+      }
+      printResult(report, "Compressed", argv[0], &result, result.inputBytes);
+    } else {
+      if (decompressStream(argv[0], argv[1], &result) < 0) {
+        exit(EXIT_FAILURE);
+      }
+      printResult(report, "Decompressed", argv[0], &result,
+                  result.outputBytes);
+    }
+    return 0;
+  }
+  if (mode == 'c' && argc == 2) {
+    if (compressFile(argv[0], argv[1], &options, &result) < 0) {
+      exit(EXIT_FAILURE);
+    }
+    printResult(stdout, "Compressed", argv[0], &result, result.inputBytes);
+    if (options.maxCodeLength < MAX_CODE_LENGTH) {
+      printf("Codes limited to %d bits: %" PRIu64 " payload bits, %" PRIu64
+             " unlimited (+%.3f%%)\n",
+             options.maxCodeLength, result.payloadBits, result.optimalBits,
+             result.optimalBits ? 100.0 * result.payloadBits /
+                                          result.optimalBits -
+                                      100.0
+                                : 0.0);
+    }
+    return 0;
+  }
+  if (mode == 'd' && extract && argc == 2) {
+    if (decompressRange(argv[0], argv[1], rangeOffset, rangeLength,
+                        &decodeOptions, &result) < 0) {
+      exit(EXIT_FAILURE);
+    }
+    printResult(stdout, "Extracted", argv[0], &result, result.outputBytes);
+    return 0;
+  }
+  if (mode == 'd' && argc == 2) {
+    if (decompressFile(argv[0], argv[1], &decodeOptions, &result) < 0) {
+      exit(EXIT_FAILURE);
+    }
+    printResult(stdout, "Decompressed", argv[0], &result, result.outputBytes);
+    return 0;
+  }
+  if (mode == 0 && argc == 1) {
+    huffman(argv[0], alphabetSize);
+    return 0;
+  }
+  if (mode != 0 || argc != 0) {
+    usage();
+  }
   char fileName[100];
   printf("Enter File Name to read:\n");
   /* Assume file names are always correct */
   fscanf(stdin, "%s", fileName);
-  huffman(fileName);
+  huffman(fileName, alphabetSize);
+  return 0;
 }
@@ -0,0 +1,389 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file implements training, saving and loading of shared code
+        tables, and coding of records with them.
+
+ */
+#include "shared.h"
+#include "bitio.h"
+#include "format.h"
+#include "histogram.h"
+#include "input.h"
+#include "stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+FNV-1a hash of a run of bytes
+@param in is the bytes to hash
+@param size is the number of bytes
+@return the hash
+*/
+static uint32_t hashBytes(const uint8_t *in, size_t size) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ in[i]) * 16777619u;
+  }
+  return hash;
+}
+
+/**
+Derives the ID of a table from its code lengths
+@param codes is the table
+@return the ID
+*/
+static uint32_t tableId(const codeTable *codes) {
+  uint8_t lengths[MAX_LENGTHS_SIZE];
+  return hashBytes(lengths, writeCodeLengths(codes, lengths));
+}
+
+/**
+Trains a table on a corpus. Every byte value gets a code, so any input can be
+coded with the table, but bytes that never appear get the longest codes.
+@param paths is the files of the corpus
+@param count is the number of files
+@param maxLength is the longest code allowed, up to MAX_CODE_LENGTH
+@param table receives the trained table
+@return 0 on success, -1 on failure with a message printed to stderr
+*/
+int trainTable(char *const *paths, int count, int maxLength,
+               sharedTable *table) {
+  uint64_t frequencies[ALPHABET_SIZE] = {0};
+  for (int i = 0; i < count; i++) {
+    inputSource input;
+    if (openInput(paths[i], &input) < 0) {
+      return -1;
+    }
+    countBytes(input.data, input.size, frequencies);
+    closeInput(&input);
+  }
+  /* Count every byte at least once so that any input can be coded */
+  for (int symbol = 0; symbol < ALPHABET_SIZE; symbol++) {
+    frequencies[symbol]++;
+  }
+  int length = computeCodeLengths(frequencies, ALPHABET_SIZE, &table->codes);
+  if (length > maxLength && limitCodeLengths(frequencies, ALPHABET_SIZE,
+                                             maxLength, &table->codes) < 0) {
+    fprintf(stderr, "Codes for every byte need at least 8 bits\n");
+    return -1;
+  }
+  assignCanonicalCodes(&table->codes);
+  table->id = tableId(&table->codes);
+  buildMultiDecodeTable(&table->codes, &table->decoder);
+  return 0;
+}
+
+/**
+Writes a table file
+@param path is the file to write
+@param table is the table to save
+@return 0 on success, -1 on failure with a message printed to stderr
+*/
+int saveTable(const char *path, const sharedTable *table) {
+  uint8_t buffer[8 + MAX_LENGTHS_SIZE];
+  storeMagic(buffer, MAGIC_TABLE);
+  store32(buffer + 4, table->id);
+  size_t size = 8 + writeCodeLengths(&table->codes, buffer + 8);
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    perror(path);
+    return -1;
+  }
+  size_t written = fwrite(buffer, 1, size, file);
+  if (fclose(file) != 0 || written != size) {
+    perror(path);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+Reads a table file into a registry
+@param path is the table file
+@param registry is the registry to add the table to
+@return 0 on success, -1 on failure with a message printed to stderr
+*/
+int loadTable(const char *path, tableRegistry *registry) {
+  if (registry->count == MAX_SHARED_TABLES) {
+    fprintf(stderr, "%s: at most %d tables can be loaded\n", path,
+            MAX_SHARED_TABLES);
+    return -1;
+  }
+  inputSource input;
+  if (openInput(path, &input) < 0) {
+    return -1;
+  }
+  sharedTable *table = &registry->tables[registry->count];
+  int status = -1;
+  if (input.size < 8 || !checkMagic(input.data, MAGIC_TABLE) ||
+      readCodeLengths(input.data + 8, input.size - 8, &table->codes) == 0) {
+    fprintf(stderr, "%s: not a table file\n", path);
+    goto done;
+  }
+  table->id = load32(input.data + 4);
+  /* The ID covers the lengths, so a damaged table cannot pose as another */
+  if (table->id != tableId(&table->codes)) {
+    fprintf(stderr, "%s: table does not match its ID\n", path);
+    goto done;
+  }
+  buildMultiDecodeTable(&table->codes, &table->decoder);
+  registry->count++;
+  status = 0;
+
+done:
+  closeInput(&input);
+  return status;
+}
+
+/**
+Looks up a table by ID
+@param registry is the registry to search
+@param id is the table ID
+@return the table, or NULL if it is not loaded
+*/
+const sharedTable *findTable(const tableRegistry *registry, uint32_t id) {
+  for (int i = 0; i < registry->count; i++) {
+    if (registry->tables[i].id == id) {
+      return &registry->tables[i];
+    }
+  }
+  return NULL;
+}
+
+/**
+Largest record encodeRecord() can produce
+@param size is the number of bytes to code
+@return the number of bytes to allow for the record
+*/
+size_t recordBound(size_t size) {
+  /* A payload of size bytes or more is stored raw, so it never grows */
+  return RECORD_HEADER_SIZE + size + BIT_WRITER_SLACK;
+}
+
+/**
+Codes a buffer as a record that refers to a shared table. If the table cannot
+shrink the bytes, they are stored as they are behind a RECORD_RAW_MARKER.
+@param table is the shared table to code with
+@param in is the bytes to code
+@param size is the number of bytes
+@param out receives at most recordBound(size) bytes
+@return the number of bytes in the record
+*/
+size_t encodeRecord(const sharedTable *table, const uint8_t *in, size_t size,
+                    uint8_t *out) {
+  uint64_t frequencies[ALPHABET_SIZE] = {0};
+  countBytes(in, size, frequencies);
+  int raw = (encodedBits(&table->codes, frequencies) + 7) / 8 >= size;
+  uint8_t *ptr = out;
+  *ptr++ = raw ? RECORD_RAW_MARKER : RECORD_MARKER;
+  store32(ptr, table->id);
+  ptr += 4;
+  uint64_t remaining = size;
+  while (remaining >= 0x80) {
+    *ptr++ = (uint8_t)(remaining | 0x80);
+    remaining >>= 7;
+  }
+  *ptr++ = (uint8_t)remaining;
+  if (raw) {
+    if (size > 0) {
+      memcpy(ptr, in, size);
+    }
+    return (size_t)(ptr + size - out);
+  }
+  bitWriter writer;
+  bitWriterInit(&writer, ptr);
+  encodeSymbols(&table->codes, in, size, &writer);
+  ptr += finishBits(&writer);
+  return (size_t)(ptr - out);
+}
+
+/**
+Reads the header of a record
+@param in is the record
+@param inSize is the number of bytes in the record
+@param id receives the ID of the table it was coded with
+@param size receives the number of bytes it decodes to
+@return the number of bytes in the header, or 0 if it is not a record
+*/
+size_t readRecordHeader(const uint8_t *in, size_t inSize, uint32_t *id,
+                        uint64_t *size) {
+  if (inSize < 6 || (in[0] != RECORD_MARKER && in[0] != RECORD_RAW_MARKER)) {
+    return 0;
+  }
+  *id = load32(in + 1);
+  *size = 0;
+  for (size_t i = 5; i < inSize && i < RECORD_HEADER_SIZE; i++) {
+    *size |= (uint64_t)(in[i] & 0x7f) << (7 * (i - 5));
+    if ((in[i] & 0x80) == 0) {
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+/**
+Decodes a record
+@param registry holds the table the record was coded with
+@param in is the record
+@param inSize is the number of bytes in the record
+@param out receives the original bytes, as many as readRecordHeader() reports
+@param outSize is the room in out
+@return the number of bytes decoded, or -1 if the record is corrupt, too big
+for out or its table is not loaded
+*/
+int64_t decodeRecord(const tableRegistry *registry, const uint8_t *in,
+                     size_t inSize, uint8_t *out, size_t outSize) {
+  uint32_t id;
+  uint64_t size;
+  size_t headerSize = readRecordHeader(in, inSize, &id, &size);
+  if (headerSize > 0 && in[0] == RECORD_RAW_MARKER) {
+    if (size != inSize - headerSize || size > outSize) {
+      return -1;
+    }
+    if (size > 0) {
+      memcpy(out, in + headerSize, size);
+    }
+    return (int64_t)size;
+  }
+  const sharedTable *table = findTable(registry, id);
+  /* Every symbol takes at least one bit */
+  if (headerSize == 0 || table == NULL || size > outSize ||
+      size > (uint64_t)(inSize - headerSize) * 8) {
+    return -1;
+  }
+  if (size > 0) {
+    decodeMultiSymbols(&table->decoder, in + headerSize, inSize - headerSize,
+                       out, size);
+  }
+  /* The payload is only padded to a whole byte, so a record that was cut
+   * short or had bytes added decodes to bytes whose codes take another size */
+  uint64_t frequencies[ALPHABET_SIZE] = {0};
+  countBytes(out, size, frequencies);
+  if ((encodedBits(&table->codes, frequencies) + 7) / 8 !=
+      inSize - headerSize) {
+    return -1;
+  }
+  return (int64_t)size;
+}
+
+/**
+Compresses a file into a record
+@param inPath is the file to compress, or "-" for standard input
+@param outPath is the file to write the record to
+@param table is the shared table to code with
+@param result receives the sizes and time taken, may be NULL
+@return 0 on success, -1 on failure with a message printed to stderr
+*/
+int compressRecord(const char *inPath, const char *outPath,
+                   const sharedTable *table, codingResult *result) {
+  double start = now();
+  inputSource input;
+  if (openInput(inPath, &input) < 0) {
+    return -1;
+  }
+  uint8_t *out = malloc(recordBound(input.size));
+  size_t size = encodeRecord(table, input.data, input.size, out);
+  int status = -1;
+  FILE *file = fopen(outPath, "wb");
+  if (file == NULL) {
+    perror(outPath);
+    goto done;
+  }
+  size_t written = fwrite(out, 1, size, file);
+  if (fclose(file) != 0 || written != size) {
+    perror(outPath);
+    goto done;
+  }
+  status = 0;
+  countStat(COUNTER_BYTES_IN, input.size);
+  countStat(COUNTER_BYTES_OUT, size);
+  if (result != NULL) {
+    uint64_t frequencies[ALPHABET_SIZE] = {0};
+    countBytes(input.data, input.size, frequencies);
+    result->inputBytes = input.size;
+    result->outputBytes = size;
+    result->payloadBits = out[0] == RECORD_RAW_MARKER
+                              ? (uint64_t)input.size * 8
+                              : encodedBits(&table->codes, frequencies);
+    result->optimalBits = result->payloadBits;
+  }
+
+done:
+  free(out);
+  closeInput(&input);
+  if (result != NULL) {
+    result->seconds = now() - start;
+  }
+  return status;
+}
+
+/**
+Decompresses a record file
+@param inPath is the record, or "-" for standard input
+@param outPath is the file to write the original data to
+@param registry holds the table the record was coded with
+@param result receives the sizes and time taken, may be NULL
+@return 0 on success, -1 on failure with a message printed to stderr
+*/
+int decompressRecord(const char *inPath, const char *outPath,
+                     const tableRegistry *registry, codingResult *result) {
+  double start = now();
+  inputSource input;
+  if (openInput(inPath, &input) < 0) {
+    return -1;
+  }
+  uint8_t *out = NULL;
+  int status = -1;
+  uint32_t id;
+  uint64_t size;
+  if (readRecordHeader(input.data, input.size, &id, &size) == 0) {
+    fprintf(stderr, "%s: not a record\n", inPath);
+    goto done;
+  }
+  if (input.data[0] != RECORD_RAW_MARKER && findTable(registry, id) == NULL) {
+    fprintf(stderr, "%s: coded with table %08x, which is not loaded\n",
+            inPath, id);
+    goto done;
+  }
+  if (size > (uint64_t)input.size * 8) {
+    fprintf(stderr, "%s: corrupt record\n", inPath);
+    goto done;
+  }
+  out = malloc(size > 0 ? size : 1);
+  if (decodeRecord(registry, input.data, input.size, out, size) < 0) {
+    fprintf(stderr, "%s: corrupt record\n", inPath);
+    goto done;
+  }
+  FILE *file = fopen(outPath, "wb");
+  if (file == NULL) {
+    perror(outPath);
+    goto done;
+  }
+  size_t written = fwrite(out, 1, size, file);
+  if (fclose(file) != 0 || written != size) {
+    perror(outPath);
+    goto done;
+  }
+  status = 0;
+  countStat(COUNTER_BYTES_IN, input.size);
+  countStat(COUNTER_BYTES_OUT, size);
+  if (result != NULL) {
+    result->inputBytes = input.size;
+    result->outputBytes = size;
+    result->payloadBits = 0;
+    result->optimalBits = 0;
+  }
+
+done:
+  free(out);
+  closeInput(&input);
+  if (result != NULL) {
+    result->seconds = now() - start;
+  }
+  return status;
+}
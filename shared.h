@@ -0,0 +1,147 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file contains the interface for pre-trained shared code
+        tables. A table is trained once from a sample corpus and saved to a
+        table file; its ID is a hash of its code lengths. Records coded with
+        a shared table only carry the table ID and their size, so even a
+        few bytes of input compress.
+
+*/
+
+#ifndef _SHARED_H_
+#define _SHARED_H_
+
+#include "decoder.h"
+#include "encoder.h"
+#include "huffman.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/** Most tables a registry holds */
+#define MAX_SHARED_TABLES 16
+/** Largest record header: marker, table ID and a 64 bit varint size */
+#define RECORD_HEADER_SIZE (1 + 4 + 10)
+
+/**
+A trained code table with its decode table built once
+*/
+typedef struct SharedTable {
+  uint32_t id;              /**< Hash of the code lengths */
+  codeTable codes;          /**< Canonical codes, one for every byte value */
+  multiDecodeTable decoder; /**< Decode table for codes */
+} sharedTable;
+
+/**
+The shared tables a program has loaded, looked up by ID
+*/
+typedef struct TableRegistry {
+  sharedTable tables[MAX_SHARED_TABLES]; /**< Loaded tables */
+  int count;                             /**< Number of loaded tables */
+} tableRegistry;
+
+/**
+Trains a table on a corpus. Every byte value gets a code, so any input can be
+coded with the table, but bytes that never appear get the longest codes.
+@param paths is the files of the corpus
+@param count is the number of files
+@param maxLength is the longest code allowed, up to MAX_CODE_LENGTH
+@param table receives the trained table
+@return 0 on success, -1 on failure with a message printed to stderr
+*/
+int trainTable(char *const *paths, int count, int maxLength,
+               sharedTable *table);
+
+/**
+Writes a table file
+@param path is the file to write
+@param table is the table to save
+@return 0 on success, -1 on failure with a message printed to stderr
+*/
+int saveTable(const char *path, const sharedTable *table);
+
+/**
+Reads a table file into a registry
+@param path is the table file
+@param registry is the registry to add the table to
+@return 0 on success, -1 on failure with a message printed to stderr
+*/
+int loadTable(const char *path, tableRegistry *registry);
+
+/**
+Looks up a table by ID
+@param registry is the registry to search
+@param id is the table ID
+@return the table, or NULL if it is not loaded
+*/
+const sharedTable *findTable(const tableRegistry *registry, uint32_t id);
+
+/**
+Largest record encodeRecord() can produce
+@param size is the number of bytes to code
+@return the number of bytes to allow for the record
+*/
+size_t recordBound(size_t size);
+
+/**
+Codes a buffer as a record that refers to a shared table. If the table cannot
+shrink the bytes, they are stored as they are behind a RECORD_RAW_MARKER.
+@param table is the shared table to code with
+@param in is the bytes to code
+@param size is the number of bytes
+@param out receives at most recordBound(size) bytes
+@return the number of bytes in the record
+*/
+size_t encodeRecord(const sharedTable *table, const uint8_t *in, size_t size,
+                    uint8_t *out);
+
+/**
+Reads the header of a record
+@param in is the record
+@param inSize is the number of bytes in the record
+@param id receives the ID of the table it was coded with
+@param size receives the number of bytes it decodes to
+@return the number of bytes in the header, or 0 if it is not a record
+*/
+size_t readRecordHeader(const uint8_t *in, size_t inSize, uint32_t *id,
+                        uint64_t *size);
+
+/**
+Decodes a record
+@param registry holds the table the record was coded with
+@param in is the record
+@param inSize is the number of bytes in the record
+@param out receives the original bytes, as many as readRecordHeader() reports
+@param outSize is the room in out
+@return the number of bytes decoded, or -1 if the record is corrupt, too big
+for out or its table is not loaded
+*/
+int64_t decodeRecord(const tableRegistry *registry, const uint8_t *in,
+                     size_t inSize, uint8_t *out, size_t outSize);
+
+/**
+Compresses a file into a record
+@param inPath is the file to compress, or "-" for standard input
+@param outPath is the file to write the record to
+@param table is the shared table to code with
+@param result receives the sizes and time taken, may be NULL
+@return 0 on success, -1 on failure with a message printed to stderr
+*/
+int compressRecord(const char *inPath, const char *outPath,
+                   const sharedTable *table, codingResult *result);
+
+/**
+Decompresses a record file
+@param inPath is the record, or "-" for standard input
+@param outPath is the file to write the original data to
+@param registry holds the table the record was coded with
+@param result receives the sizes and time taken, may be NULL
+@return 0 on success, -1 on failure with a message printed to stderr
+*/
+int decompressRecord(const char *inPath, const char *outPath,
+                     const tableRegistry *registry, codingResult *result);
+
+#endif
@@ -0,0 +1,79 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file implements run statistics. Timers and counters are plain
+        global totals that every thread adds to with relaxed atomics, so
+        a worker never waits on another to record its work. Peak memory
+        comes from the kernel's resident set high water mark.
+
+ */
+#include "stats.h"
+#include <sys/resource.h>
+#include <time.h>
+
+int statsEnabled = 0;
+uint64_t phaseNanoseconds[PHASE_COUNT];
+uint64_t phaseCalls[PHASE_COUNT];
+uint64_t statCounters[COUNTER_COUNT];
+
+/** Names of the phases in the report */
+static const char *phaseNames[PHASE_COUNT] = {
+    "read", "histogram", "tree", "codes", "encode", "decode", "write", "print",
+};
+
+/** Names of the counters in the report */
+static const char *counterNames[COUNTER_COUNT] = {
+    "bytes_in", "bytes_out",  "blocks",     "repeated_tables",
+    "nodes",    "heap_sifts", "sift_steps",
+};
+
+/** When enableStats() was called */
+static uint64_t startTime;
+
+/**
+Monotonic clock for phase timers
+@return nanoseconds since an arbitrary point in the past
+*/
+uint64_t statClock(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/**
+Starts collecting statistics and the wall clock of the run
+*/
+void enableStats(void) {
+  startTime = statClock();
+  statsEnabled = 1;
+}
+
+/**
+Prints the statistics as one JSON object
+@param out is where to print
+@param command names the run, for example "compress"
+@return 0 on success, -1 if the statistics could not be written
+*/
+int writeStats(FILE *out, const char *command) {
+  struct rusage usage;
+  long peakKiB = getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;
+  fprintf(out, "{\"command\": \"%s\", \"wall_seconds\": %.6f,", command,
+          (statClock() - startTime) / 1e9);
+  fprintf(out, " \"phases\": {");
+  for (int i = 0; i < PHASE_COUNT; i++) {
+    fprintf(out, "%s\"%s\": {\"seconds\": %.6f, \"calls\": %llu}",
+            i > 0 ? ", " : "", phaseNames[i], phaseNanoseconds[i] / 1e9,
+            (unsigned long long)phaseCalls[i]);
+  }
+  fprintf(out, "}, \"counters\": {");
+  for (int i = 0; i < COUNTER_COUNT; i++) {
+    fprintf(out, "%s\"%s\": %llu", i > 0 ? ", " : "", counterNames[i],
+            (unsigned long long)statCounters[i]);
+  }
+  fprintf(out, "}, \"peak_memory_bytes\": %llu}\n",
+          (unsigned long long)peakKiB * 1024);
+  return fflush(out) == 0 && !ferror(out) ? 0 : -1;
+}
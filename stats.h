@@ -0,0 +1,106 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file contains the interface for run statistics: time spent in
+        each phase of coding and counters of the work done, summed over
+        every thread and printed as JSON. Everything is off until
+        enableStats() is called; until then a timer or counter costs one
+        well predicted branch.
+
+*/
+
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+/** Phases of coding that are timed */
+enum {
+  PHASE_READ,      /**< Opening and reading inputs */
+  PHASE_HISTOGRAM, /**< Counting symbol frequencies */
+  PHASE_TREE,      /**< Building trees or code lengths and choosing tables */
+  PHASE_CODES,     /**< Assigning codes to a tree */
+  PHASE_ENCODE,    /**< Coding blocks */
+  PHASE_DECODE,    /**< Decoding blocks */
+  PHASE_WRITE,     /**< Writing outputs */
+  PHASE_PRINT,     /**< Printing code tables */
+  PHASE_COUNT
+};
+
+/** Counters of work done */
+enum {
+  COUNTER_BYTES_IN,        /**< Bytes read */
+  COUNTER_BYTES_OUT,       /**< Bytes written */
+  COUNTER_BLOCKS,          /**< Blocks coded or decoded */
+  COUNTER_REPEATED_TABLES, /**< Blocks that repeat the previous table */
+  COUNTER_NODES,           /**< Tree nodes allocated */
+  COUNTER_HEAP_SIFTS,      /**< Heap sifts up or down */
+  COUNTER_SIFT_STEPS,      /**< Levels moved by heap sifts */
+  COUNTER_COUNT
+};
+
+/** Whether statistics are being collected */
+extern int statsEnabled;
+/** Nanoseconds spent in each phase, summed over threads */
+extern uint64_t phaseNanoseconds[PHASE_COUNT];
+/** Number of times each phase ran */
+extern uint64_t phaseCalls[PHASE_COUNT];
+/** Value of each counter */
+extern uint64_t statCounters[COUNTER_COUNT];
+
+/**
+Monotonic clock for phase timers
+@return nanoseconds since an arbitrary point in the past
+*/
+uint64_t statClock(void);
+
+/**
+Starts collecting statistics and the wall clock of the run
+*/
+void enableStats(void);
+
+/**
+Adds to a counter
+@param counter is one of the COUNTER_ values
+@param amount is the amount to add
+*/
+static inline void countStat(int counter, uint64_t amount) {
+  if (__builtin_expect(statsEnabled, 0)) {
+    __atomic_fetch_add(&statCounters[counter], amount, __ATOMIC_RELAXED);
+  }
+}
+
+/**
+Starts timing a phase
+@return the start time to pass to endPhase()
+*/
+static inline uint64_t startPhase(void) {
+  return __builtin_expect(statsEnabled, 0) ? statClock() : 0;
+}
+
+/**
+Adds the time since startPhase() to a phase
+@param phase is one of the PHASE_ values
+@param start is the value startPhase() returned
+*/
+static inline void endPhase(int phase, uint64_t start) {
+  if (__builtin_expect(statsEnabled, 0)) {
+    __atomic_fetch_add(&phaseNanoseconds[phase], statClock() - start,
+                       __ATOMIC_RELAXED);
+    __atomic_fetch_add(&phaseCalls[phase], 1, __ATOMIC_RELAXED);
+  }
+}
+
+/**
+Prints the statistics as one JSON object
+@param out is where to print
+@param command names the run, for example "compress"
+@return 0 on success, -1 if the statistics could not be written
+*/
+int writeStats(FILE *out, const char *command);
+
+#endif
@@ -0,0 +1,170 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        Tests adaptive streams. Every generated input is compressed in one
+        pass and must come back unchanged. A stream cut short at many
+        lengths, or with a wrong magic, must be refused. A stream fed
+        through a pipe must be decoded and written out as it arrives,
+        before the pipe is closed.
+
+        Usage: tests/adaptive
+ */
+#include "adaptive.h"
+#include "check.h"
+#include <pthread.h>
+#include <sys/stat.h>
+#include <time.h>
+
+/** Longest the live test waits for output, in milliseconds */
+#define LIVE_WAIT 5000
+
+/**
+Feeds the first half of a stream into a pipe, waits for decoded output to
+appear, then feeds the rest
+*/
+typedef struct LiveFeed {
+  int pipe;            /**< Write end of the pipe */
+  const uint8_t *data; /**< Stream */
+  size_t size;         /**< Number of bytes in data */
+  int sawOutput;       /**< Set if output appeared before the rest was fed */
+} liveFeed;
+
+/**
+Compresses and decompresses every input as an adaptive stream
+@param inputs is the inputs
+*/
+static void testRoundTrip(const testInput *inputs) {
+  for (int i = 0; i < INPUT_COUNT; i++) {
+    const testInput *input = &inputs[i];
+    writeFile("in", input->data, input->size);
+    CHECK(compressStream("in", "in.hus", NULL) == 0 &&
+              decompressStream("in.hus", "out", NULL) == 0 &&
+              sameContents("out", input->data, input->size),
+          "-A: round trip %s", input->name);
+  }
+}
+
+/**
+Decompresses a damaged adaptive stream
+@param data is the damaged stream
+@param size is the number of bytes in data
+@return the status of decompressStream()
+*/
+static int decompressDamaged(const uint8_t *data, size_t size) {
+  writeFile("bad.hus", data, size);
+  hideErrors(1);
+  int status = decompressStream("bad.hus", "out", NULL);
+  hideErrors(0);
+  return status;
+}
+
+/**
+Cuts an adaptive stream short at many lengths and damages its magic
+@param input is the input to compress
+*/
+static void testDamage(const testInput *input) {
+  writeFile("in", input->data, input->size);
+  compressStream("in", "in.hus", NULL);
+  size_t size;
+  uint8_t *data = readFile("in.hus", &size);
+  if (!CHECK(data != NULL, "-A: compress %s", input->name)) {
+    return;
+  }
+  for (size_t cut = nextCut(size, SIZE_MAX); cut != SIZE_MAX;
+       cut = nextCut(size, cut)) {
+    CHECK(decompressDamaged(data, cut) < 0, "-A: %s cut to %zu bytes accepted",
+          input->name, cut);
+  }
+  data[2] = MAGIC_FILE;
+  CHECK(decompressDamaged(data, size) < 0, "-A: %s with a bad magic accepted",
+        input->name);
+  free(data);
+}
+
+/**
+Writes a whole buffer to a descriptor
+@param fd is the descriptor
+@param data is the buffer
+@param size is the number of bytes in data
+*/
+static void writeAll(int fd, const uint8_t *data, size_t size) {
+  while (size > 0) {
+    ssize_t written = write(fd, data, size);
+    if (written <= 0) {
+      return;
+    }
+    data += written;
+    size -= (size_t)written;
+  }
+}
+
+/**
+Thread that feeds a stream into a pipe in two parts
+@param argument is the liveFeed
+@return NULL
+*/
+static void *feedPipe(void *argument) {
+  liveFeed *feed = argument;
+  writeAll(feed->pipe, feed->data, feed->size / 2);
+  const struct timespec pause = {0, 1000000};
+  struct stat info;
+  for (int i = 0; i < LIVE_WAIT && !feed->sawOutput; i++) {
+    feed->sawOutput = stat("out", &info) == 0 && info.st_size > 0;
+    nanosleep(&pause, NULL);
+  }
+  writeAll(feed->pipe, feed->data + feed->size / 2,
+           feed->size - feed->size / 2);
+  close(feed->pipe);
+  return NULL;
+}
+
+/**
+Decodes a stream that arrives through a pipe, which must be written out as it
+arrives rather than when a buffer fills or the stream ends
+@param input is the input to compress
+*/
+static void testLive(const testInput *input) {
+  writeFile("in", input->data, input->size);
+  compressStream("in", "in.hus", NULL);
+  size_t size;
+  uint8_t *data = readFile("in.hus", &size);
+  int fds[2];
+  if (!CHECK(data != NULL && pipe(fds) == 0, "-A: compress %s", input->name)) {
+    free(data);
+    return;
+  }
+  remove("out");
+  liveFeed feed = {fds[1], data, size, 0};
+  pthread_t thread;
+  pthread_create(&thread, NULL, feedPipe, &feed);
+  char path[32];
+  snprintf(path, sizeof(path), "/dev/fd/%d", fds[0]);
+  int status = decompressStream(path, "out", NULL);
+  pthread_join(thread, NULL);
+  close(fds[0]);
+  CHECK(status == 0 && sameContents("out", input->data, input->size),
+        "-A: round trip %s through a pipe", input->name);
+  CHECK(feed.sawOutput, "-A: nothing of %s written before the pipe closed",
+        input->name);
+  free(data);
+}
+
+int main(void) {
+  testInput inputs[INPUT_COUNT];
+  makeInputs(inputs);
+  if (enterScratchDir() < 0) {
+    return EXIT_FAILURE;
+  }
+  testRoundTrip(inputs);
+  testLive(&inputs[5]);
+  shortenInputs(inputs);
+  for (int i = 0; i < INPUT_COUNT; i++) {
+    testDamage(&inputs[i]);
+  }
+  leaveScratchDir();
+  freeInputs(inputs);
+  return reportTests("adaptive");
+}
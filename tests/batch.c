@@ -0,0 +1,206 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        Tests batch mode. Every generated input is compressed in one batch,
+        into an archive and next to the originals, and both must decompress
+        to the inputs. Archives cut short must be refused. Paths that would
+        extract outside the current directory, and two paths that name the
+        same member, must be refused when archiving and when extracting.
+
+        Usage: tests/batch
+ */
+#include "batch.h"
+#include "check.h"
+#include <sys/stat.h>
+
+/** Names of the files the inputs are written to */
+static char names[INPUT_COUNT][16];
+/** Paths of the files the inputs are written to */
+static char *paths[INPUT_COUNT];
+
+/**
+Writes every input to a file
+@param inputs is the inputs
+*/
+static void writeInputs(const testInput *inputs) {
+  for (int i = 0; i < INPUT_COUNT; i++) {
+    snprintf(names[i], sizeof(names[i]), "file%d", i);
+    paths[i] = names[i];
+    writeFile(names[i], inputs[i].data, inputs[i].size);
+  }
+}
+
+/**
+Compresses every input in one batch, into an archive and next to the
+originals, and decompresses both
+@param inputs is the inputs
+*/
+static void testRoundTrip(const testInput *inputs) {
+  char packed[INPUT_COUNT][16];
+  char *packedPaths[INPUT_COUNT];
+  encoderOptions options;
+  defaultEncoderOptions(&options);
+  options.blockSize = 4096;
+  options.threads = 3;
+  decoderOptions decoder;
+  defaultDecoderOptions(&decoder);
+  decoder.threads = 3;
+  writeInputs(inputs);
+  for (int i = 0; i < INPUT_COUNT; i++) {
+    snprintf(packed[i], sizeof(packed[i]), "file%d%s", i, BATCH_SUFFIX);
+    packedPaths[i] = packed[i];
+  }
+  batchResult result;
+  char *archive[] = {"all.hua"};
+  CHECK(compressBatch(paths, INPUT_COUNT, &options, archive[0], &result) ==
+                0 &&
+            result.files == INPUT_COUNT,
+        "-b -o: compress");
+  CHECK(compressBatch(paths, INPUT_COUNT, &options, NULL, &result) == 0,
+        "-b: compress");
+  for (int i = 0; i < INPUT_COUNT; i++) {
+    remove(names[i]);
+  }
+  CHECK(decompressBatch(archive, 1, &decoder, &result) == 0 &&
+            result.files == INPUT_COUNT,
+        "-b: extract archive");
+  for (int i = 0; i < INPUT_COUNT; i++) {
+    CHECK(sameContents(names[i], inputs[i].data, inputs[i].size),
+          "-b: archive member %s", inputs[i].name);
+    remove(names[i]);
+  }
+  CHECK(decompressBatch(packedPaths, INPUT_COUNT, &decoder, &result) == 0,
+        "-b: decompress");
+  for (int i = 0; i < INPUT_COUNT; i++) {
+    CHECK(sameContents(names[i], inputs[i].data, inputs[i].size),
+          "-b: file %s", inputs[i].name);
+    remove(packed[i]);
+  }
+}
+
+/**
+Extracts an archive
+@param data is the archive
+@param size is the number of bytes in data
+@return the status of decompressBatch()
+*/
+static int extract(const uint8_t *data, size_t size) {
+  char *archive[] = {"bad.hua"};
+  decoderOptions decoder;
+  defaultDecoderOptions(&decoder);
+  batchResult result;
+  writeFile(archive[0], data, size);
+  hideErrors(1);
+  int status = decompressBatch(archive, 1, &decoder, &result);
+  hideErrors(0);
+  return status;
+}
+
+/**
+Cuts an archive short at many lengths
+@param inputs is the inputs to archive
+*/
+static void testCuts(const testInput *inputs) {
+  encoderOptions options;
+  defaultEncoderOptions(&options);
+  writeInputs(inputs);
+  batchResult result;
+  compressBatch(paths, INPUT_COUNT, &options, "all.hua", &result);
+  size_t size;
+  uint8_t *data = readFile("all.hua", &size);
+  if (!CHECK(data != NULL, "-b -o: compress")) {
+    return;
+  }
+  for (size_t cut = nextCut(size, SIZE_MAX); cut != SIZE_MAX;
+       cut = nextCut(size, cut)) {
+    CHECK(extract(data, cut) < 0, "-b: archive cut to %zu bytes accepted",
+          cut);
+  }
+  free(data);
+}
+
+/**
+Archives paths that must be refused, and checks that no archive is written
+@param list is the paths
+@param count is the number of paths
+@param what describes the paths
+*/
+static void checkRefused(char **list, int count, const char *what) {
+  encoderOptions options;
+  defaultEncoderOptions(&options);
+  batchResult result;
+  remove("bad.hua");
+  hideErrors(1);
+  int status = compressBatch(list, count, &options, "bad.hua", &result);
+  hideErrors(0);
+  CHECK(status < 0 && access("bad.hua", F_OK) != 0, "-b -o: %s accepted",
+        what);
+}
+
+/**
+Refuses to archive or extract paths outside the current directory and paths
+that name the same member
+*/
+static void testPaths(void) {
+  static const uint8_t text[] = "member";
+  mkdir("dir", 0777);
+  writeFile("dir/x", text, sizeof(text));
+  writeFile("y", text, sizeof(text));
+  char *outside[] = {"y", "dir/../y"};
+  checkRefused(outside, 2, "a .. component");
+  char *same[] = {"dir/x", "./dir//x"};
+  checkRefused(same, 2, "two paths of one file");
+  char *fine[] = {"./dir//x", "y"};
+  encoderOptions options;
+  defaultEncoderOptions(&options);
+  batchResult result;
+  CHECK(compressBatch(fine, 2, &options, "good.hua", &result) == 0,
+        "-b -o: ./dir//x and y refused");
+
+  /* The member of dir/x stored twice, then under ".." and "." components
+   * of the same length */
+  size_t size;
+  uint8_t *data = readFile("good.hua", &size);
+  if (!CHECK(data != NULL && size > ARCHIVE_HEADER_SIZE + 2 + 5,
+             "-b -o: read the archive")) {
+    free(data);
+    return;
+  }
+  size_t memberSize = 2 + 5 + 8 + load64(data + ARCHIVE_HEADER_SIZE + 2 + 5);
+  uint8_t *twice = malloc(size + memberSize);
+  memcpy(twice, data, ARCHIVE_HEADER_SIZE + memberSize);
+  memcpy(twice + ARCHIVE_HEADER_SIZE + memberSize, data + ARCHIVE_HEADER_SIZE,
+         memberSize);
+  memset(twice + ARCHIVE_HEADER_SIZE + 2 * memberSize, 0,
+         ARCHIVE_FOOTER_SIZE);
+  CHECK(extract(twice, ARCHIVE_HEADER_SIZE + 2 * memberSize +
+                           ARCHIVE_FOOTER_SIZE) < 0,
+        "-b: archive with a member stored twice accepted");
+  static const char *const unsafe[] = {"../xy", "./x/y", "d//xy"};
+  for (int i = 0; i < 3; i++) {
+    memcpy(data + ARCHIVE_HEADER_SIZE + 2, unsafe[i], 5);
+    CHECK(extract(data, size) < 0, "-b: member %s extracted", unsafe[i]);
+  }
+  free(twice);
+  free(data);
+  remove("dir/x");
+  rmdir("dir");
+}
+
+int main(void) {
+  testInput inputs[INPUT_COUNT];
+  makeInputs(inputs);
+  if (enterScratchDir() < 0) {
+    return EXIT_FAILURE;
+  }
+  testRoundTrip(inputs);
+  shortenInputs(inputs);
+  testCuts(inputs);
+  testPaths();
+  leaveScratchDir();
+  freeInputs(inputs);
+  return reportTests("batch");
+}
@@ -0,0 +1,63 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        Tests block-parallel compression. Every generated input is
+        compressed in blocks of several sizes with one and with several
+        threads, and decompressed with several threads. The files must come
+        back unchanged, and the number of threads must not change a single
+        byte of the compressed file.
+
+        Usage: tests/blocks
+ */
+#include "check.h"
+
+/** Block sizes that are tested, from tiny to the default */
+static const int blockSizes[] = {7, 4096, DEFAULT_BLOCK_SIZE};
+
+/**
+Compresses every input in blocks with one and with three threads
+@param inputs is the inputs
+*/
+static void testBlocks(const testInput *inputs) {
+  encoderOptions options;
+  defaultEncoderOptions(&options);
+  decoderOptions decoder;
+  defaultDecoderOptions(&decoder);
+  decoder.threads = 3;
+  for (size_t b = 0; b < sizeof(blockSizes) / sizeof(blockSizes[0]); b++) {
+    options.blockSize = blockSizes[b];
+    for (int i = 0; i < INPUT_COUNT; i++) {
+      size_t serialSize, parallelSize;
+      options.threads = 1;
+      CHECK(fileRoundTrip(&inputs[i], &options, &decoder),
+            "-B %d -j 1: round trip %s", blockSizes[b], inputs[i].name);
+      uint8_t *serial = readFile("in.huf", &serialSize);
+      options.threads = 3;
+      CHECK(fileRoundTrip(&inputs[i], &options, &decoder),
+            "-B %d -j 3: round trip %s", blockSizes[b], inputs[i].name);
+      uint8_t *parallel = readFile("in.huf", &parallelSize);
+      CHECK(serial != NULL && parallel != NULL &&
+                serialSize == parallelSize &&
+                memcmp(serial, parallel, serialSize) == 0,
+            "-B %d: %s differs between -j 1 and -j 3", blockSizes[b],
+            inputs[i].name);
+      free(serial);
+      free(parallel);
+    }
+  }
+}
+
+int main(void) {
+  testInput inputs[INPUT_COUNT];
+  makeInputs(inputs);
+  if (enterScratchDir() < 0) {
+    return EXIT_FAILURE;
+  }
+  testBlocks(inputs);
+  leaveScratchDir();
+  freeInputs(inputs);
+  return reportTests("blocks");
+}
@@ -0,0 +1,85 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        Tests the tree builders. Every generated input is compressed with
+        the code lengths computed in place and with the min heap tree (-H).
+        Both must come back unchanged, and as both give optimal codes the
+        compressed files must be the same size. Counts too big for the keys
+        of the min heap must still give optimal codes.
+
+        Usage: tests/builders
+ */
+#include "check.h"
+
+/**
+Compresses every input with both builders and compares the results
+@param inputs is the inputs
+*/
+static void testBuilders(const testInput *inputs) {
+  encoderOptions inPlace, heap;
+  defaultEncoderOptions(&inPlace);
+  defaultEncoderOptions(&heap);
+  heap.builder = BUILD_HEAP;
+  decoderOptions decoder;
+  defaultDecoderOptions(&decoder);
+  for (int i = 0; i < INPUT_COUNT; i++) {
+    size_t inPlaceSize, heapSize;
+    CHECK(fileRoundTrip(&inputs[i], &inPlace, &decoder), "round trip %s",
+          inputs[i].name);
+    free(readFile("in.huf", &inPlaceSize));
+    CHECK(fileRoundTrip(&inputs[i], &heap, &decoder), "-H: round trip %s",
+          inputs[i].name);
+    free(readFile("in.huf", &heapSize));
+    CHECK(inPlaceSize == heapSize, "-H: %s is %zu bytes, not %zu",
+          inputs[i].name, heapSize, inPlaceSize);
+  }
+}
+
+/**
+Bits a code table spends on symbols with the given counts
+@param table is the code table
+@param frequencies is the number of times each symbol appears
+@return the number of bits
+*/
+static uint64_t codedBits(const codeTable *table, const uint64_t *frequencies) {
+  uint64_t bits = 0;
+  for (int symbol = 0; symbol < ALPHABET_SIZE; symbol++) {
+    bits += frequencies[symbol] * table->length[symbol];
+  }
+  return bits;
+}
+
+/**
+Builds a min heap tree for counts past the 48 bits of a heap key, which must
+cost as few bits as the lengths computed in place
+*/
+static void testHugeCounts(void) {
+  uint64_t frequencies[ALPHABET_SIZE] = {0};
+  for (int symbol = 0; symbol < 4; symbol++) {
+    frequencies['a' + symbol] = (UINT64_C(1) << 50) + symbol;
+  }
+  frequencies['z'] = 1;
+  static heap tree;
+  buildHuffmanTree(frequencies, ALPHABET_SIZE, &tree);
+  codeTable fromTree, inPlace;
+  buildCodeTable(&tree, &fromTree);
+  computeCodeLengths(frequencies, ALPHABET_SIZE, &inPlace);
+  CHECK(codedBits(&fromTree, frequencies) == codedBits(&inPlace, frequencies),
+        "-H: counts of 2^50 are not coded optimally");
+}
+
+int main(void) {
+  testInput inputs[INPUT_COUNT];
+  makeInputs(inputs);
+  if (enterScratchDir() < 0) {
+    return EXIT_FAILURE;
+  }
+  testBuilders(inputs);
+  testHugeCounts();
+  leaveScratchDir();
+  freeInputs(inputs);
+  return reportTests("builders");
+}
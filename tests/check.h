@@ -0,0 +1,345 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file holds the helpers shared by the tests: a check that
+        counts failures, generated inputs, whole file reads and writes, a
+        scratch directory the tests work in, a switch that hides the
+        messages of calls that are expected to fail, file round trips, the
+        frame types of a compressed file and the lengths damaged copies
+        are cut to.
+
+ */
+#ifndef _CHECK_H_
+#define _CHECK_H_
+
+#include "decoder.h"
+#include "encoder.h"
+#include "format.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/** Lengths cut from each end, every one of them tested */
+#define CUT_EDGE 48
+/** Lengths cut from the middle of the data, evenly spread */
+#define CUT_STEPS 64
+/** Most bytes of each input that are coded and then damaged */
+#define DAMAGE_SIZE 20000
+
+/** Bit for a frame type in a set of seen types */
+#define FRAME(type) (1u << (type))
+/** Bit for the repeated table flag in a set of seen types */
+#define FRAME_REPEAT (1u << 7)
+
+/** Number of generated inputs */
+#define INPUT_COUNT 6
+/** Size of the bigger generated inputs, several blocks of 4 KiB */
+#define INPUT_SIZE 150000
+
+/** Checks failed so far */
+static int failures;
+
+/**
+Records a failed check if a condition does not hold
+@param ok is the condition
+@param file is the source file of the check
+@param line is the line of the check
+@param format describes the check, printf style
+@return ok
+*/
+static inline int checkThat(int ok, const char *file, int line,
+                            const char *format, ...) {
+  if (!ok) {
+    va_list args;
+    va_start(args, format);
+    printf("%s:%d: FAIL ", file, line);
+    vprintf(format, args);
+    printf("\n");
+    va_end(args);
+    failures++;
+  }
+  return ok;
+}
+
+/** Checks a condition, printing the description if it does not hold */
+#define CHECK(ok, ...) checkThat((ok) != 0, __FILE__, __LINE__, __VA_ARGS__)
+
+/**
+A generated input
+*/
+typedef struct TestInput {
+  const char *name; /**< What the input is like */
+  uint8_t *data;    /**< Contents */
+  size_t size;      /**< Number of bytes in data */
+} testInput;
+
+/**
+Next value of a xorshift generator, so every run sees the same inputs
+@param state is the generator state, not zero
+@return the next value
+*/
+static inline uint64_t nextRandom(uint64_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+/**
+Generates the inputs every test codes: empty, one byte, one byte value,
+random bytes, bytes with a skewed distribution and words of text
+@param inputs receives INPUT_COUNT inputs
+*/
+static inline void makeInputs(testInput *inputs) {
+  static const char *const words[] = {"the ",   "huffman ", "code ", "of ",
+                                      "a ",     "block ",   "tree ", "is\n",
+                                      "stream ", "and ",    "bits ", "zero "};
+  uint64_t state = 88172645463325252ull;
+  static const char *const names[INPUT_COUNT] = {
+      "empty", "one byte", "one value", "random", "skewed", "text"};
+  static const size_t sizes[INPUT_COUNT] = {
+      0, 1, INPUT_SIZE, INPUT_SIZE, INPUT_SIZE, INPUT_SIZE};
+  for (int i = 0; i < INPUT_COUNT; i++) {
+    inputs[i].name = names[i];
+    inputs[i].size = sizes[i];
+    inputs[i].data = malloc(sizes[i] > 0 ? sizes[i] : 1);
+  }
+  inputs[1].data[0] = 'x';
+  memset(inputs[2].data, 'a', INPUT_SIZE);
+  for (size_t i = 0; i < INPUT_SIZE; i++) {
+    inputs[3].data[i] = (uint8_t)nextRandom(&state);
+    /* Each value is half as likely as the one before, so codes get long */
+    uint64_t bits = nextRandom(&state);
+    inputs[4].data[i] = (uint8_t)(bits ? __builtin_ctzll(bits) : 64);
+  }
+  for (size_t i = 0; i < INPUT_SIZE;) {
+    const char *word = words[nextRandom(&state) % 12];
+    while (*word != '\0' && i < INPUT_SIZE) {
+      inputs[5].data[i++] = (uint8_t)*word++;
+    }
+  }
+}
+
+/**
+Shortens the inputs to DAMAGE_SIZE, as a few blocks are enough to damage and
+keep the many damaged copies quick
+@param inputs is the INPUT_COUNT inputs
+*/
+static inline void shortenInputs(testInput *inputs) {
+  for (int i = 0; i < INPUT_COUNT; i++) {
+    inputs[i].size = inputs[i].size < DAMAGE_SIZE ? inputs[i].size
+                                                  : DAMAGE_SIZE;
+  }
+}
+
+/**
+Frees the generated inputs
+@param inputs is the INPUT_COUNT inputs
+*/
+static inline void freeInputs(testInput *inputs) {
+  for (int i = 0; i < INPUT_COUNT; i++) {
+    free(inputs[i].data);
+  }
+}
+
+/**
+Writes a whole file
+@param path is the file to write
+@param data is the contents
+@param size is the number of bytes in data
+@return 0 on success, -1 on failure
+*/
+static inline int writeFile(const char *path, const uint8_t *data,
+                            size_t size) {
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    return -1;
+  }
+  size_t written = fwrite(data, 1, size, file);
+  return fclose(file) != 0 || written != size ? -1 : 0;
+}
+
+/**
+Reads a whole file
+@param path is the file to read
+@param size receives the number of bytes read
+@return the contents, to be freed, or NULL if it cannot be read
+*/
+static inline uint8_t *readFile(const char *path, size_t *size) {
+  *size = 0;
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return NULL;
+  }
+  fseek(file, 0, SEEK_END);
+  long length = ftell(file);
+  rewind(file);
+  uint8_t *data = malloc(length > 0 ? (size_t)length : 1);
+  *size = fread(data, 1, (size_t)length, file);
+  fclose(file);
+  if (*size != (size_t)length) {
+    free(data);
+    return NULL;
+  }
+  return data;
+}
+
+/**
+Checks whether a file holds exactly the given bytes
+@param path is the file
+@param data is the expected contents
+@param size is the number of bytes in data
+@return 1 if they match, 0 otherwise
+*/
+static inline int sameContents(const char *path, const uint8_t *data,
+                               size_t size) {
+  size_t fileSize;
+  uint8_t *contents = readFile(path, &fileSize);
+  int same = contents != NULL && fileSize == size &&
+             (size == 0 || memcmp(contents, data, size) == 0);
+  free(contents);
+  return same;
+}
+
+/** Standard error while it is hidden, or -1 */
+static int savedStderr = -1;
+
+/**
+Hides or restores standard error, for calls that print a message on the
+failures the tests provoke
+@param hide is 1 to hide it, 0 to restore it
+*/
+static inline void hideErrors(int hide) {
+  fflush(stderr);
+  if (hide && savedStderr < 0) {
+    savedStderr = dup(STDERR_FILENO);
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDERR_FILENO);
+    close(null);
+  } else if (!hide && savedStderr >= 0) {
+    dup2(savedStderr, STDERR_FILENO);
+    close(savedStderr);
+    savedStderr = -1;
+  }
+}
+
+/** Path of the scratch directory */
+static char scratchDir[] = "/tmp/huffman-test-XXXXXX";
+
+/**
+Creates a scratch directory and makes it the current directory, so that every
+path the tests use is relative, as archive members must be
+@return 0 on success, -1 on failure
+*/
+static inline int enterScratchDir(void) {
+  if (mkdtemp(scratchDir) == NULL || chdir(scratchDir) != 0) {
+    perror(scratchDir);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+Removes the scratch directory and the files in it
+*/
+static inline void leaveScratchDir(void) {
+  /* Removing entries while reading the directory may skip some, so it is
+   * read again until nothing is left to remove */
+  for (int removed = 1; removed;) {
+    DIR *dir = opendir(".");
+    struct dirent *entry;
+    removed = 0;
+    while (dir != NULL && (entry = readdir(dir)) != NULL) {
+      if (strcmp(entry->d_name, ".") != 0 &&
+          strcmp(entry->d_name, "..") != 0 && remove(entry->d_name) == 0) {
+        removed = 1;
+      }
+    }
+    if (dir != NULL) {
+      closedir(dir);
+    }
+  }
+  if (chdir("/") == 0) {
+    rmdir(scratchDir);
+  }
+}
+
+/**
+Compresses an input as a file and decompresses it again
+@param input is the input
+@param options are the encoder settings
+@param decoder are the decoder settings
+@return 1 if it came back unchanged, 0 otherwise
+*/
+static inline int fileRoundTrip(const testInput *input,
+                                const encoderOptions *options,
+                                const decoderOptions *decoder) {
+  return writeFile("in", input->data, input->size) == 0 &&
+         compressFile("in", "in.huf", options, NULL) == 0 &&
+         decompressFile("in.huf", "out", decoder, NULL) == 0 &&
+         sameContents("out", input->data, input->size);
+}
+
+/**
+Collects the types of the frames of a compressed file through its index
+@param path is the compressed file
+@return FRAME() bits of the types seen, with FRAME_REPEAT for the flag
+*/
+static inline unsigned frameTypes(const char *path) {
+  size_t size;
+  uint8_t *data = readFile(path, &size);
+  unsigned seen = 0;
+  if (data == NULL || size < HEADER_SIZE + FOOTER_SIZE) {
+    free(data);
+    return 0;
+  }
+  uint64_t originalSize = load64(data + 4);
+  uint64_t blockSize = load32(data + 12);
+  uint64_t blockCount = (originalSize + blockSize - 1) / blockSize;
+  const uint8_t *index = data + load64(data + size - FOOTER_SIZE);
+  for (uint64_t i = 0; i < blockCount; i++) {
+    uint8_t type = data[load64(index + i * INDEX_ENTRY_SIZE)];
+    seen |= FRAME(type & ~BLOCK_REPEAT_TABLE);
+    if (type & BLOCK_REPEAT_TABLE) {
+      seen |= FRAME_REPEAT;
+    }
+  }
+  free(data);
+  return seen;
+}
+
+/**
+Gives the lengths a damaged copy is cut to: all of the shortest and longest
+ones, and a spread of those in between
+@param size is the length of the undamaged data
+@param step is the previous length, or SIZE_MAX to start
+@return the next length below size, or SIZE_MAX when done
+*/
+static inline size_t nextCut(size_t size, size_t step) {
+  size_t next = step == SIZE_MAX ? 0 : step + 1;
+  size_t spread = size / CUT_STEPS > 0 ? size / CUT_STEPS : 1;
+  if (next > CUT_EDGE && next + CUT_EDGE < size) {
+    next = step + spread < size - CUT_EDGE ? step + spread : size - CUT_EDGE;
+  }
+  return next < size ? next : SIZE_MAX;
+}
+
+/**
+Prints whether a test program passed
+@param name is the program
+@return the exit status of the program
+*/
+static inline int reportTests(const char *name) {
+  printf("%s: %s\n", name, failures > 0 ? "FAILED" : "passed");
+  return failures > 0 ? EXIT_FAILURE : 0;
+}
+
+#endif
@@ -0,0 +1,208 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        Tests the streaming codec. Every generated input is coded as a
+        block stream fed in small pieces, each into exactly the room
+        compressBound() asks for, and decoded with small input and output
+        pieces, and must come back unchanged. A stream cut short at many
+        lengths, or with a wrong version, must be refused. Bytes flipped at
+        random must never make the decoder read or write out of bounds.
+
+        Usage: tests/codec
+ */
+#include "check.h"
+#include "codec.h"
+
+/** Bytes fed to the streaming codec at a time */
+#define CODEC_PIECE 1000
+/** Room given to the streaming decoder at a time */
+#define CODEC_OUT_PIECE 777
+/** Bytes flipped, one at a time, in each random corruption test */
+#define FLIPS 200
+
+/**
+Encoder settings under test
+*/
+typedef struct CodecSet {
+  const char *name; /**< Command line that selects the settings */
+  int blockSize;    /**< See encoderOptions */
+  int streams;      /**< See encoderOptions */
+  int contextOrder; /**< See encoderOptions */
+} codecSet;
+
+/** Every set of settings that is tested */
+static const codecSet codecSets[] = {
+    {"defaults", DEFAULT_BLOCK_SIZE, 1, 0}, {"-B 4K", 4096, 1, 0},
+    {"-B 7", 7, 1, 0},                      {"-s 4 -B 8K", 8192, 4, 0},
+    {"-O 1 -B 16K", 16384, 1, 1},
+};
+
+/**
+Codes an input as a block stream fed in small pieces, each given exactly the
+room compressBound() asks for
+@param input is the input
+@param options are the encoder settings
+@param size receives the number of bytes in the stream
+@return the stream, to be freed, or NULL on failure
+*/
+static uint8_t *compressPieces(const testInput *input,
+                               const encoderOptions *options, size_t *size) {
+  compressor *c = createCompressor(options);
+  if (c == NULL) {
+    return NULL;
+  }
+  size_t capacity = compressBound(c, 0);
+  uint8_t *stream = malloc(capacity);
+  *size = 0;
+  int64_t written = 0;
+  for (size_t offset = 0; offset < input->size && written >= 0;
+       offset += CODEC_PIECE) {
+    size_t piece = input->size - offset < CODEC_PIECE ? input->size - offset
+                                                      : CODEC_PIECE;
+    capacity = *size + compressBound(c, piece);
+    stream = realloc(stream, capacity);
+    written = compressUpdate(c, input->data + offset, piece, stream + *size,
+                             capacity - *size);
+    *size += written > 0 ? (size_t)written : 0;
+  }
+  if (written >= 0) {
+    capacity = *size + compressBound(c, 0);
+    stream = realloc(stream, capacity);
+    written = compressEnd(c, stream + *size, capacity - *size);
+  }
+  freeCompressor(c);
+  if (written < 0) {
+    free(stream);
+    return NULL;
+  }
+  *size += (size_t)written;
+  return stream;
+}
+
+/**
+Decodes a block stream with small input and output pieces
+@param stream is the stream
+@param size is the number of bytes in the stream
+@param input is the input it must decode to
+@return 1 if it came back unchanged, 0 otherwise
+*/
+static int decompressPieces(const uint8_t *stream, size_t size,
+                            const testInput *input) {
+  decompressor *d = createDecompressor();
+  uint8_t *out = malloc(input->size + 1);
+  size_t used, consumed = 0, produced = 0;
+  int ok = d != NULL;
+  while (ok) {
+    size_t piece = size - consumed < CODEC_PIECE / 3 ? size - consumed
+                                                     : CODEC_PIECE / 3;
+    size_t room = input->size + 1 - produced;
+    room = room < CODEC_OUT_PIECE ? room : CODEC_OUT_PIECE;
+    int64_t decoded = decompressUpdate(d, stream + consumed, piece, &used,
+                                       out + produced, room);
+    if (decoded < 0) {
+      ok = 0;
+      break;
+    }
+    consumed += used;
+    produced += (size_t)decoded;
+    if (decoded == 0 && used == 0) {
+      break;
+    }
+  }
+  ok = ok && decompressEnd(d) == 0 && consumed == size &&
+       produced == input->size &&
+       (produced == 0 || memcmp(out, input->data, produced) == 0);
+  freeDecompressor(d);
+  free(out);
+  return ok;
+}
+
+/**
+Codes every input with the streaming codec and every set of settings
+@param inputs is the inputs
+*/
+static void testRoundTrip(const testInput *inputs) {
+  for (size_t s = 0; s < sizeof(codecSets) / sizeof(codecSets[0]); s++) {
+    encoderOptions options;
+    defaultEncoderOptions(&options);
+    options.blockSize = codecSets[s].blockSize;
+    options.streams = codecSets[s].streams;
+    options.contextOrder = codecSets[s].contextOrder;
+    for (int i = 0; i < INPUT_COUNT; i++) {
+      size_t size;
+      uint8_t *stream = compressPieces(&inputs[i], &options, &size);
+      CHECK(stream != NULL && decompressPieces(stream, size, &inputs[i]),
+            "%s: round trip %s", codecSets[s].name, inputs[i].name);
+      free(stream);
+    }
+  }
+}
+
+/**
+Decodes a damaged block stream in one call
+@param data is the damaged stream
+@param size is the number of bytes in data
+@param outSize is the room for the decoded bytes
+@return 0 if the whole stream decoded, -1 otherwise
+*/
+static int decodeDamaged(const uint8_t *data, size_t size, size_t outSize) {
+  decompressor *d = createDecompressor();
+  uint8_t *out = malloc(outSize + 1);
+  size_t used;
+  int64_t decoded = decompressUpdate(d, data, size, &used, out, outSize + 1);
+  int status = decoded >= 0 && decompressEnd(d) == 0 && used == size ? 0 : -1;
+  freeDecompressor(d);
+  free(out);
+  return status;
+}
+
+/**
+Cuts a block stream short and damages its header, and flips bytes at random
+@param input is the input to compress
+*/
+static void testDamage(const testInput *input) {
+  encoderOptions options;
+  defaultEncoderOptions(&options);
+  options.blockSize = 4096;
+  options.streams = 4;
+  size_t size;
+  uint8_t *data = compressPieces(input, &options, &size);
+  if (!CHECK(data != NULL && decodeDamaged(data, size, input->size) == 0,
+             "stream of %s not decoded", input->name)) {
+    free(data);
+    return;
+  }
+  for (size_t cut = nextCut(size, SIZE_MAX); cut != SIZE_MAX;
+       cut = nextCut(size, cut)) {
+    CHECK(decodeDamaged(data, cut, input->size) < 0,
+          "stream of %s cut to %zu bytes accepted", input->name, cut);
+  }
+  uint8_t *bad = malloc(size);
+  memcpy(bad, data, size);
+  bad[3] = FORMAT_VERSION + 1;
+  CHECK(decodeDamaged(bad, size, input->size) < 0,
+        "stream of %s with a bad version accepted", input->name);
+  uint64_t state = 3141592653ull;
+  for (int i = 0; i < FLIPS; i++) {
+    memcpy(bad, data, size);
+    bad[nextRandom(&state) % size] ^= 0x5a;
+    decodeDamaged(bad, size, input->size);
+  }
+  free(bad);
+  free(data);
+}
+
+int main(void) {
+  testInput inputs[INPUT_COUNT];
+  makeInputs(inputs);
+  testRoundTrip(inputs);
+  shortenInputs(inputs);
+  for (int i = 0; i < INPUT_COUNT; i++) {
+    testDamage(&inputs[i]);
+  }
+  freeInputs(inputs);
+  return reportTests("codec");
+}
@@ -0,0 +1,71 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        Tests order-1 context coding. Every generated input is compressed
+        with -O 1 in default and small blocks and must come back unchanged,
+        the compressed files must hold context frames, and text must come
+        out smaller than with order 0.
+
+        Usage: tests/context
+ */
+#include "check.h"
+
+/** Block sizes that are tested */
+static const int blockSizes[] = {16384, DEFAULT_BLOCK_SIZE};
+
+/**
+Compresses every input with order 1 in blocks of each size
+@param inputs is the inputs
+*/
+static void testContext(const testInput *inputs) {
+  encoderOptions options;
+  defaultEncoderOptions(&options);
+  options.contextOrder = 1;
+  decoderOptions decoder;
+  defaultDecoderOptions(&decoder);
+  for (size_t b = 0; b < sizeof(blockSizes) / sizeof(blockSizes[0]); b++) {
+    options.blockSize = blockSizes[b];
+    unsigned seen = 0;
+    for (int i = 0; i < INPUT_COUNT; i++) {
+      CHECK(fileRoundTrip(&inputs[i], &options, &decoder),
+            "-O 1 -B %d: round trip %s", blockSizes[b], inputs[i].name);
+      seen |= frameTypes("in.huf");
+    }
+    CHECK(seen & FRAME(BLOCK_CONTEXT), "-O 1 -B %d: no context frames",
+          blockSizes[b]);
+  }
+}
+
+/**
+Checks that the context of the previous byte shrinks text
+@param text is the text input
+*/
+static void testGain(const testInput *text) {
+  encoderOptions options;
+  defaultEncoderOptions(&options);
+  size_t order0, order1;
+  writeFile("in", text->data, text->size);
+  compressFile("in", "in.huf", &options, NULL);
+  free(readFile("in.huf", &order0));
+  options.contextOrder = 1;
+  compressFile("in", "in.huf", &options, NULL);
+  free(readFile("in.huf", &order1));
+  CHECK(order1 < order0, "-O 1: text is %zu bytes, %zu with order 0", order1,
+        order0);
+}
+
+int main(void) {
+  testInput inputs[INPUT_COUNT];
+  makeInputs(inputs);
+  if (enterScratchDir() < 0) {
+    return EXIT_FAILURE;
+  }
+  testContext(inputs);
+  testGain(&inputs[5]);
+  leaveScratchDir();
+  freeInputs(inputs);
+  return reportTests("context");
+}
@@ -0,0 +1,66 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        Tests the raw and run fallbacks. Random bytes must be stored raw and
+        a single byte value as runs, and every generated input must come
+        back unchanged and never grow by more than the frame headers and
+        index of its blocks.
+
+        Usage: tests/fallback
+ */
+#include "check.h"
+
+/** Block sizes that are tested */
+static const int blockSizes[] = {7, 4096, DEFAULT_BLOCK_SIZE};
+
+/**
+Compresses every input in blocks of each size and checks its frames and size
+@param inputs is the inputs
+*/
+static void testFallback(const testInput *inputs) {
+  encoderOptions options;
+  defaultEncoderOptions(&options);
+  decoderOptions decoder;
+  defaultDecoderOptions(&decoder);
+  for (size_t b = 0; b < sizeof(blockSizes) / sizeof(blockSizes[0]); b++) {
+    options.blockSize = blockSizes[b];
+    for (int i = 0; i < INPUT_COUNT; i++) {
+      const testInput *input = &inputs[i];
+      CHECK(fileRoundTrip(input, &options, &decoder), "-B %d: round trip %s",
+            blockSizes[b], input->name);
+      size_t blocks = (input->size + blockSizes[b] - 1) / blockSizes[b];
+      size_t size;
+      free(readFile("in.huf", &size));
+      CHECK(size <= HEADER_SIZE + FOOTER_SIZE + input->size +
+                        blocks * (BLOCK_HEADER_SIZE + INDEX_ENTRY_SIZE),
+            "-B %d: %s grew to %zu bytes", blockSizes[b], input->name, size);
+    }
+    /* Text was compressed last; blocks of 7 bytes are too small to code */
+    CHECK(blockSizes[b] < 64 ||
+              (frameTypes("in.huf") & ~FRAME_REPEAT) == FRAME(BLOCK_HUFFMAN),
+          "-B %d: text is not coded", blockSizes[b]);
+    writeFile("in", inputs[3].data, inputs[3].size);
+    compressFile("in", "in.huf", &options, NULL);
+    CHECK(frameTypes("in.huf") == FRAME(BLOCK_RAW), "-B %d: random is not raw",
+          blockSizes[b]);
+    writeFile("in", inputs[2].data, inputs[2].size);
+    compressFile("in", "in.huf", &options, NULL);
+    CHECK(frameTypes("in.huf") == FRAME(BLOCK_RUN),
+          "-B %d: one value is not a run", blockSizes[b]);
+  }
+}
+
+int main(void) {
+  testInput inputs[INPUT_COUNT];
+  makeInputs(inputs);
+  if (enterScratchDir() < 0) {
+    return EXIT_FAILURE;
+  }
+  testFallback(inputs);
+  leaveScratchDir();
+  freeInputs(inputs);
+  return reportTests("fallback");
+}
@@ -0,0 +1,87 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        Tests compressed files. Every generated input is compressed and
+        decompressed with the default settings and must come back
+        unchanged. A compressed file cut short at any length, or with a
+        wrong magic or version, must be refused.
+
+        Usage: tests/files
+ */
+#include "check.h"
+#include "format.h"
+
+/**
+Compresses and decompresses every input with the default settings
+@param inputs is the inputs
+*/
+static void testRoundTrip(const testInput *inputs) {
+  encoderOptions options;
+  defaultEncoderOptions(&options);
+  decoderOptions decoder;
+  defaultDecoderOptions(&decoder);
+  for (int i = 0; i < INPUT_COUNT; i++) {
+    CHECK(fileRoundTrip(&inputs[i], &options, &decoder), "round trip %s",
+          inputs[i].name);
+  }
+}
+
+/**
+Decompresses a damaged compressed file
+@param data is the damaged file
+@param size is the number of bytes in data
+@return the status of decompressFile()
+*/
+static int decompressDamaged(const uint8_t *data, size_t size) {
+  writeFile("bad.huf", data, size);
+  hideErrors(1);
+  int status = decompressFile("bad.huf", "out", NULL, NULL);
+  hideErrors(0);
+  return status;
+}
+
+/**
+Cuts a compressed file short at many lengths and damages its header
+@param input is the input to compress
+*/
+static void testDamage(const testInput *input) {
+  writeFile("in", input->data, input->size);
+  compressFile("in", "in.huf", NULL, NULL);
+  size_t size;
+  uint8_t *data = readFile("in.huf", &size);
+  if (!CHECK(data != NULL, "compress %s", input->name)) {
+    return;
+  }
+  for (size_t cut = nextCut(size, SIZE_MAX); cut != SIZE_MAX;
+       cut = nextCut(size, cut)) {
+    CHECK(decompressDamaged(data, cut) < 0, "%s cut to %zu bytes accepted",
+          input->name, cut);
+  }
+  data[2] = MAGIC_BLOCKS;
+  CHECK(decompressDamaged(data, size) < 0, "%s with a bad magic accepted",
+        input->name);
+  data[2] = MAGIC_FILE;
+  data[3] = FORMAT_VERSION - 1;
+  CHECK(decompressDamaged(data, size) < 0, "%s with a bad version accepted",
+        input->name);
+  free(data);
+}
+
+int main(void) {
+  testInput inputs[INPUT_COUNT];
+  makeInputs(inputs);
+  if (enterScratchDir() < 0) {
+    return EXIT_FAILURE;
+  }
+  testRoundTrip(inputs);
+  shortenInputs(inputs);
+  for (int i = 0; i < INPUT_COUNT; i++) {
+    testDamage(&inputs[i]);
+  }
+  leaveScratchDir();
+  freeInputs(inputs);
+  return reportTests("files");
+}
@@ -0,0 +1,176 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        Tests the block index. Byte ranges that start, end and cross
+        blocks are extracted from every generated input and must match
+        it. Frames of an unknown type and frames or indexes that point past
+        the data must be refused, as must an index whose blocks share one
+        frame to claim more original bytes than the file can hold. Bytes
+        flipped at random may go unnoticed in a payload, but must never
+        make the decoder read or write out of bounds, which a build with
+        -fsanitize=address checks.
+
+        Usage: tests/index
+ */
+#include "check.h"
+
+/** Bytes flipped, one at a time, in each random corruption test */
+#define FLIPS 200
+
+/** Block sizes that are tested */
+static const int blockSizes[] = {7, 4096, DEFAULT_BLOCK_SIZE};
+
+/**
+Extracts byte ranges from every input compressed in blocks of each size
+@param inputs is the inputs
+*/
+static void testRanges(const testInput *inputs) {
+  encoderOptions options;
+  defaultEncoderOptions(&options);
+  decoderOptions decoder;
+  defaultDecoderOptions(&decoder);
+  for (size_t b = 0; b < sizeof(blockSizes) / sizeof(blockSizes[0]); b++) {
+    options.blockSize = blockSizes[b];
+    for (int i = 0; i < INPUT_COUNT; i++) {
+      const testInput *input = &inputs[i];
+      writeFile("in", input->data, input->size);
+      if (!CHECK(compressFile("in", "in.huf", &options, NULL) == 0,
+                 "-B %d: compress %s", blockSizes[b], input->name)) {
+        continue;
+      }
+      /* Ranges that start, end and cross blocks */
+      const uint64_t ranges[][2] = {{0, 1},
+                                    {(uint64_t)blockSizes[b] - 1, 2},
+                                    {input->size / 3, input->size / 2},
+                                    {0, input->size}};
+      for (int r = 0; r < 4; r++) {
+        uint64_t offset = ranges[r][0], length = ranges[r][1];
+        if (offset + length > input->size || length == 0) {
+          continue;
+        }
+        CHECK(decompressRange("in.huf", "out", offset, length, &decoder,
+                              NULL) == 0 &&
+                  sameContents("out", input->data + offset, length),
+              "-B %d: range %llu+%llu of %s", blockSizes[b],
+              (unsigned long long)offset, (unsigned long long)length,
+              input->name);
+      }
+      hideErrors(1);
+      int status = decompressRange("in.huf", "out", input->size, 1, &decoder,
+                                   NULL);
+      hideErrors(0);
+      CHECK(status < 0, "-B %d: range past the end of %s accepted",
+            blockSizes[b], input->name);
+    }
+  }
+}
+
+/**
+Decompresses a damaged compressed file
+@param data is the damaged file
+@param size is the number of bytes in data
+@return the status of decompressFile()
+*/
+static int decompressDamaged(const uint8_t *data, size_t size) {
+  writeFile("bad.huf", data, size);
+  hideErrors(1);
+  int status = decompressFile("bad.huf", "out", NULL, NULL);
+  hideErrors(0);
+  return status;
+}
+
+/**
+Damages the frames and index of a compressed file of several blocks, and
+flips bytes at random
+@param input is the input to compress
+*/
+static void testDamage(const testInput *input) {
+  encoderOptions options;
+  defaultEncoderOptions(&options);
+  options.blockSize = 4096;
+  writeFile("in", input->data, input->size);
+  compressFile("in", "in.huf", &options, NULL);
+  size_t size;
+  uint8_t *data = readFile("in.huf", &size);
+  if (!CHECK(data != NULL, "compress %s", input->name)) {
+    return;
+  }
+  uint8_t *bad = malloc(size);
+  uint64_t indexOffset = load64(data + size - FOOTER_SIZE);
+  uint64_t firstFrame = load64(data + indexOffset);
+  /* Unknown frame type, frame past the index, index entry past the frames,
+   * index offset before the header */
+  const struct {
+    const char *what;
+    size_t offset;
+    uint8_t value;
+  } damage[] = {
+      {"frame type", firstFrame, 0x7f},
+      {"frame size", firstFrame + 4, 0x7f},
+      {"index entry", indexOffset + 6, 0x7f},
+      {"index offset", size - FOOTER_SIZE, 0},
+  };
+  for (size_t i = 0; i < sizeof(damage) / sizeof(damage[0]); i++) {
+    if (damage[i].offset >= size) {
+      continue;
+    }
+    memcpy(bad, data, size);
+    bad[damage[i].offset] = damage[i].value;
+    CHECK(decompressDamaged(bad, size) < 0, "%s with a bad %s accepted",
+          input->name, damage[i].what);
+  }
+  /* Nothing checks a payload or the original size, so a flipped byte may
+   * decode to other bytes; it only must not take the decoder out of bounds */
+  uint64_t state = 2463534242ull;
+  for (int i = 0; i < FLIPS; i++) {
+    memcpy(bad, data, size);
+    bad[nextRandom(&state) % size] ^= (uint8_t)(1 + nextRandom(&state) % 255);
+    decompressDamaged(bad, size);
+  }
+  free(bad);
+  free(data);
+}
+
+/**
+Points many index entries at one run frame of the largest block, which would
+claim gigabytes from a file of a few hundred bytes
+*/
+static void testSharedFrame(void) {
+  enum { BLOCKS = 64 };
+  uint8_t data[HEADER_SIZE + MIN_FRAME_SIZE + BLOCKS * INDEX_ENTRY_SIZE +
+               FOOTER_SIZE] = {0};
+  storeMagic(data, MAGIC_FILE);
+  store64(data + 4, (uint64_t)BLOCKS * MAX_BLOCK_SIZE);
+  store32(data + 12, MAX_BLOCK_SIZE);
+  uint8_t *frame = data + HEADER_SIZE;
+  frame[0] = BLOCK_RUN;
+  store32(frame + 1, 1);
+  frame[BLOCK_HEADER_SIZE] = 'a';
+  uint8_t *index = frame + MIN_FRAME_SIZE;
+  for (int i = 0; i < BLOCKS; i++) {
+    store64(index + i * INDEX_ENTRY_SIZE, HEADER_SIZE);
+  }
+  store64(index + BLOCKS * INDEX_ENTRY_SIZE, (uint64_t)(index - data));
+  CHECK(decompressDamaged(data, sizeof(data)) < 0,
+        "%d blocks sharing one frame accepted", BLOCKS);
+}
+
+int main(void) {
+  testInput inputs[INPUT_COUNT];
+  makeInputs(inputs);
+  if (enterScratchDir() < 0) {
+    return EXIT_FAILURE;
+  }
+  testRanges(inputs);
+  shortenInputs(inputs);
+  for (int i = 0; i < INPUT_COUNT; i++) {
+    testDamage(&inputs[i]);
+  }
+  testSharedFrame();
+  leaveScratchDir();
+  freeInputs(inputs);
+  return reportTests("index");
+}
@@ -0,0 +1,91 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        Tests length-limited codes. The limited lengths of every generated
+        input must stay within the limit, form a prefix code and cost no
+        less than the unlimited ones. Files compressed with -L must come
+        back unchanged, and a limit too small for the alphabet must be
+        refused.
+
+        Usage: tests/limit
+ */
+#include "check.h"
+#include "histogram.h"
+
+/** Limits that are tested, from none to the smallest most inputs allow */
+static const int limits[] = {MAX_CODE_LENGTH, 12, 9, 8};
+
+/**
+Limits the code lengths of every input and checks the codes
+@param inputs is the inputs
+*/
+static void testLengths(const testInput *inputs) {
+  for (int i = 0; i < INPUT_COUNT; i++) {
+    uint64_t counts[ALPHABET_SIZE] = {0};
+    countBytes(inputs[i].data, inputs[i].size, counts);
+    codeTable optimal = {{0}, {0}};
+    computeCodeLengths(counts, ALPHABET_SIZE, &optimal);
+    for (size_t l = 0; l < sizeof(limits) / sizeof(limits[0]); l++) {
+      codeTable table = {{0}, {0}};
+      int longest = limitCodeLengths(counts, ALPHABET_SIZE, limits[l], &table);
+      CHECK(longest <= limits[l] && assignCanonicalCodes(&table) == 0,
+            "-L %d: lengths of %s", limits[l], inputs[i].name);
+      CHECK(encodedBits(&table, counts) >= encodedBits(&optimal, counts),
+            "-L %d: %s beats the optimal code", limits[l], inputs[i].name);
+    }
+  }
+}
+
+/**
+Round trips every input with limited codes from both builders
+@param inputs is the inputs
+*/
+static void testFiles(const testInput *inputs) {
+  encoderOptions options;
+  defaultEncoderOptions(&options);
+  decoderOptions decoder;
+  defaultDecoderOptions(&decoder);
+  for (int i = 0; i < INPUT_COUNT; i++) {
+    options.builder = BUILD_IN_PLACE;
+    options.maxCodeLength = 9;
+    CHECK(fileRoundTrip(&inputs[i], &options, &decoder), "-L 9: round trip %s",
+          inputs[i].name);
+    options.builder = BUILD_HEAP;
+    options.maxCodeLength = 7;
+    CHECK(fileRoundTrip(&inputs[i], &options, &decoder),
+          "-H -L 7: round trip %s", inputs[i].name);
+  }
+}
+
+/**
+Checks that a code length limit too small for the alphabet is refused
+@param inputs is the inputs
+*/
+static void testLimitTooSmall(const testInput *inputs) {
+  encoderOptions options;
+  defaultEncoderOptions(&options);
+  /* The skewed input has more than 8 byte values */
+  options.maxCodeLength = 3;
+  writeFile("in", inputs[4].data, inputs[4].size);
+  hideErrors(1);
+  int status = compressFile("in", "in.huf", &options, NULL);
+  hideErrors(0);
+  CHECK(status < 0, "-L 3: skewed input was not refused");
+}
+
+int main(void) {
+  testInput inputs[INPUT_COUNT];
+  makeInputs(inputs);
+  if (enterScratchDir() < 0) {
+    return EXIT_FAILURE;
+  }
+  testLengths(inputs);
+  testFiles(inputs);
+  testLimitTooSmall(inputs);
+  leaveScratchDir();
+  freeInputs(inputs);
+  return reportTests("limit");
+}
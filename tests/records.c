@@ -0,0 +1,150 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        Tests shared tables and records. A table is trained on the text
+        input, saved and loaded, and every generated input is coded as a
+        record in memory and through files and must come back unchanged.
+        Records stay within their bound, random bytes are stored raw, and
+        records cut short or lengthened, and table files cut short or
+        changed, must be refused.
+
+        Usage: tests/records
+ */
+#include "check.h"
+#include "shared.h"
+
+/** Tables loaded by the tests, too big for the stack */
+static tableRegistry registry, other;
+
+/**
+Trains a table on the text input, saves it and loads it into the registry
+@param text is the text input
+@param table receives the trained table
+@return 1 on success, 0 otherwise
+*/
+static int makeTable(const testInput *text, sharedTable *table) {
+  char *corpus[] = {"corpus"};
+  writeFile("corpus", text->data, text->size);
+  return CHECK(trainTable(corpus, 1, MAX_CODE_LENGTH, table) == 0 &&
+                   saveTable("table.hut", table) == 0 &&
+                   loadTable("table.hut", &registry) == 0,
+               "-T: train, save and load a table");
+}
+
+/**
+Codes every input as a record, in memory and through files
+@param inputs is the inputs
+@param table is the trained table
+*/
+static void testRoundTrip(const testInput *inputs, const sharedTable *table) {
+  for (int i = 0; i < INPUT_COUNT; i++) {
+    const testInput *input = &inputs[i];
+    size_t bound = recordBound(input->size);
+    uint8_t *record = malloc(bound);
+    uint8_t *out = malloc(input->size + 1);
+    size_t size = encodeRecord(table, input->data, input->size, record);
+    CHECK(size <= bound, "-t: record of %s is past its bound", input->name);
+    CHECK(size <= RECORD_HEADER_SIZE + input->size,
+          "-t: record of %s is bigger than stored", input->name);
+    CHECK(decodeRecord(&registry, record, size, out, input->size) ==
+                  (int64_t)input->size &&
+              (input->size == 0 ||
+               memcmp(out, input->data, input->size) == 0),
+          "-t: round trip %s", input->name);
+    writeFile("in", input->data, input->size);
+    CHECK(compressRecord("in", "in.rec", table, NULL) == 0 &&
+              decompressRecord("in.rec", "out", &registry, NULL) == 0 &&
+              sameContents("out", input->data, input->size),
+          "-t: round trip %s through files", input->name);
+    free(record);
+    free(out);
+  }
+  /* Random bytes cannot be shrunk by a table for text, and text can */
+  uint8_t *record = malloc(recordBound(INPUT_SIZE));
+  encodeRecord(table, inputs[3].data, inputs[3].size, record);
+  CHECK(record[0] == RECORD_RAW_MARKER, "-t: random record is not raw");
+  encodeRecord(table, inputs[5].data, inputs[5].size, record);
+  CHECK(record[0] == RECORD_MARKER, "-t: text record is raw");
+  free(record);
+}
+
+/**
+Cuts records short at every length and lengthens them
+@param inputs is the inputs
+@param table is the trained table
+*/
+static void testDamage(const testInput *inputs, const sharedTable *table) {
+  /* The text is coded and the random bytes are stored raw */
+  for (int i = 3; i < INPUT_COUNT; i += 2) {
+    const testInput *input = &inputs[i];
+    uint8_t *record = malloc(recordBound(input->size) + 1);
+    uint8_t *out = malloc(input->size);
+    size_t size = encodeRecord(table, input->data, input->size, record);
+    for (size_t cut = 0; cut < size; cut++) {
+      CHECK(decodeRecord(&registry, record, cut, out, input->size) < 0,
+            "-t: record of %s cut to %zu bytes accepted", input->name, cut);
+    }
+    record[size] = 0;
+    CHECK(decodeRecord(&registry, record, size + 1, out, input->size) < 0,
+          "-t: record of %s with a byte added accepted", input->name);
+    CHECK(decodeRecord(&registry, record, size, out, input->size - 1) < 0,
+          "-t: record of %s decoded into too little room", input->name);
+    free(record);
+    free(out);
+  }
+}
+
+/**
+Loads a damaged table file
+@param data is the damaged file
+@param size is the number of bytes in data
+@return the status of loadTable()
+*/
+static int loadDamaged(const uint8_t *data, size_t size) {
+  writeFile("bad.hut", data, size);
+  hideErrors(1);
+  int status = loadTable("bad.hut", &other);
+  hideErrors(0);
+  return status;
+}
+
+/**
+Cuts the saved table file short at every length and changes a code length
+*/
+static void testTableDamage(void) {
+  size_t size;
+  uint8_t *data = readFile("table.hut", &size);
+  if (!CHECK(data != NULL && size > 0, "-T: read the table")) {
+    free(data);
+    return;
+  }
+  for (size_t cut = 0; cut < size; cut++) {
+    CHECK(loadDamaged(data, cut) < 0, "-t: table cut to %zu bytes accepted",
+          cut);
+  }
+  data[size - 1] ^= 1;
+  CHECK(loadDamaged(data, size) < 0,
+        "-t: table with a changed code length accepted");
+  free(data);
+}
+
+int main(void) {
+  testInput inputs[INPUT_COUNT];
+  makeInputs(inputs);
+  if (enterScratchDir() < 0) {
+    return EXIT_FAILURE;
+  }
+  sharedTable table;
+  if (makeTable(&inputs[5], &table)) {
+    testRoundTrip(inputs, &table);
+    shortenInputs(inputs);
+    testDamage(inputs, &table);
+    testTableDamage();
+  }
+  leaveScratchDir();
+  freeInputs(inputs);
+  return reportTests("records");
+}
@@ -0,0 +1,149 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        Tests table reuse across blocks. Every generated input is
+        compressed in small blocks, which must come back unchanged, and the
+        compressed files must repeat tables. A frame that repeats a table
+        must be no bigger than the frame of the same block compressed on
+        its own with a fresh table.
+
+        Usage: tests/repeat
+ */
+#include "check.h"
+
+/**
+Encoder settings under test
+*/
+typedef struct RepeatSet {
+  const char *name; /**< Command line that selects the settings */
+  int blockSize;    /**< See encoderOptions */
+  int streams;      /**< See encoderOptions */
+} repeatSet;
+
+/** Every set of settings that is tested */
+static const repeatSet repeatSets[] = {
+    {"-B 4K", 4096, 1},
+    {"-B 16K", 16384, 1},
+    {"-s 4 -B 8K", 8192, 4},
+};
+
+/**
+Size of the only frame of a compressed file
+@param path is the compressed file of one block
+@return the number of bytes in the frame, or 0 if there is none
+*/
+static size_t onlyFrameSize(const char *path) {
+  size_t size;
+  uint8_t *data = readFile(path, &size);
+  size_t frameSize = 0;
+  if (data != NULL && size >= HEADER_SIZE + FOOTER_SIZE + INDEX_ENTRY_SIZE) {
+    uint64_t index = load64(data + size - FOOTER_SIZE);
+    frameSize = (size_t)(index - load64(data + index));
+  }
+  free(data);
+  return frameSize;
+}
+
+/**
+Compares every frame that repeats a table with a fresh table for its block
+@param input is the input, compressed to in.huf
+@param options are the encoder settings it was compressed with
+@param name names the settings
+*/
+static void checkRepeats(const testInput *input, encoderOptions options,
+                         const char *name) {
+  size_t size;
+  uint8_t *data = readFile("in.huf", &size);
+  if (data == NULL || size < HEADER_SIZE + FOOTER_SIZE) {
+    free(data);
+    return;
+  }
+  size_t blockSize = (size_t)options.blockSize;
+  uint64_t blockCount = (input->size + blockSize - 1) / blockSize;
+  uint64_t indexOffset = load64(data + size - FOOTER_SIZE);
+  const uint8_t *index = data + indexOffset;
+  for (uint64_t i = 0; i < blockCount; i++) {
+    uint64_t offset = load64(index + i * INDEX_ENTRY_SIZE);
+    if (!(data[offset] & BLOCK_REPEAT_TABLE)) {
+      continue;
+    }
+    uint64_t end = i + 1 < blockCount
+                       ? load64(index + (i + 1) * INDEX_ENTRY_SIZE)
+                       : indexOffset;
+    size_t start = (size_t)i * blockSize;
+    size_t length =
+        input->size - start < blockSize ? input->size - start : blockSize;
+    writeFile("block", input->data + start, length);
+    compressFile("block", "block.huf", &options, NULL);
+    size_t fresh = onlyFrameSize("block.huf");
+    CHECK(end - offset <= fresh,
+          "%s: block %llu of %s repeats a table in %llu bytes, fresh is %zu",
+          name, (unsigned long long)i, input->name,
+          (unsigned long long)(end - offset), fresh);
+  }
+  free(data);
+}
+
+/**
+Compresses every input with each set and checks the repeated tables
+@param inputs is the inputs
+*/
+static void testRepeat(const testInput *inputs) {
+  decoderOptions decoder;
+  defaultDecoderOptions(&decoder);
+  for (size_t s = 0; s < sizeof(repeatSets) / sizeof(repeatSets[0]); s++) {
+    const repeatSet *set = &repeatSets[s];
+    encoderOptions options;
+    defaultEncoderOptions(&options);
+    options.blockSize = set->blockSize;
+    options.streams = set->streams;
+    unsigned seen = 0;
+    for (int i = 0; i < INPUT_COUNT; i++) {
+      CHECK(fileRoundTrip(&inputs[i], &options, &decoder), "%s: round trip %s",
+            set->name, inputs[i].name);
+      seen |= frameTypes("in.huf");
+      checkRepeats(&inputs[i], options, set->name);
+    }
+    CHECK(seen & FRAME_REPEAT, "%s: no table was repeated", set->name);
+  }
+}
+
+/**
+Compresses blocks of twelve letters after a block that also holds every other
+byte value once. The table of the first block covers the letters, but its
+code lengths are many times the size of a fresh table's for them.
+*/
+static void testWideTable(void) {
+  encoderOptions options;
+  defaultEncoderOptions(&options);
+  options.blockSize = 4096;
+  testInput input = {"letters after every byte", malloc(4 * 4096), 4 * 4096};
+  uint64_t state = 1181783497276652981ull;
+  for (size_t i = 0; i < input.size; i++) {
+    input.data[i] = (uint8_t)('a' + nextRandom(&state) % 12);
+  }
+  for (int value = 0; value < ALPHABET_SIZE; value++) {
+    input.data[value * 16] = (uint8_t)value;
+  }
+  writeFile("in", input.data, input.size);
+  CHECK(compressFile("in", "in.huf", &options, NULL) == 0, "compress %s",
+        input.name);
+  checkRepeats(&input, options, "-B 4K");
+  free(input.data);
+}
+
+int main(void) {
+  testInput inputs[INPUT_COUNT];
+  makeInputs(inputs);
+  if (enterScratchDir() < 0) {
+    return EXIT_FAILURE;
+  }
+  testRepeat(inputs);
+  testWideTable();
+  leaveScratchDir();
+  freeInputs(inputs);
+  return reportTests("repeat");
+}
@@ -0,0 +1,57 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        Tests interleaved streams. Every generated input is compressed
+        with blocks split into several streams and must come back
+        unchanged, and the compressed files must hold stream frames.
+
+        Usage: tests/streams
+ */
+#include "check.h"
+
+/** Stream counts that are tested, up to the most a block can have */
+static const int streamCounts[] = {2, 3, 4, MAX_STREAMS};
+/** Block sizes that are tested */
+static const int blockSizes[] = {8192, DEFAULT_BLOCK_SIZE};
+
+/**
+Compresses every input with each stream count, in default and small blocks
+@param inputs is the inputs
+*/
+static void testStreams(const testInput *inputs) {
+  encoderOptions options;
+  defaultEncoderOptions(&options);
+  decoderOptions decoder;
+  defaultDecoderOptions(&decoder);
+  for (size_t s = 0; s < sizeof(streamCounts) / sizeof(streamCounts[0]);
+       s++) {
+    options.streams = streamCounts[s];
+    for (size_t b = 0; b < sizeof(blockSizes) / sizeof(blockSizes[0]); b++) {
+      int blockSize = options.blockSize = blockSizes[b];
+      unsigned seen = 0;
+      for (int i = 0; i < INPUT_COUNT; i++) {
+        CHECK(fileRoundTrip(&inputs[i], &options, &decoder),
+              "-s %d -B %d: round trip %s", streamCounts[s], blockSize,
+              inputs[i].name);
+        seen |= frameTypes("in.huf");
+      }
+      CHECK(seen & FRAME(BLOCK_STREAMS), "-s %d -B %d: no stream frames",
+            streamCounts[s], blockSize);
+    }
+  }
+}
+
+int main(void) {
+  testInput inputs[INPUT_COUNT];
+  makeInputs(inputs);
+  if (enterScratchDir() < 0) {
+    return EXIT_FAILURE;
+  }
+  testStreams(inputs);
+  leaveScratchDir();
+  freeInputs(inputs);
+  return reportTests("streams");
+}
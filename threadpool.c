@@ -0,0 +1,146 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file implements the thread pool with a mutex protected linked
+        list of tasks and two condition variables.
+
+ */
+#include "threadpool.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+/**
+ Number of processors available to this process
+ @return a positive number of processors
+ */
+int processorCount(void) {
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0 ? (int)count : 1;
+}
+
+/**
+ Worker loop: take tasks from the queue until the pool stops
+ @param argument is the pool
+ @return NULL
+ */
+static void *worker(void *argument) {
+  threadPool *pool = argument;
+  pthread_mutex_lock(&pool->lock);
+  while (1) {
+    while (pool->head == NULL && !pool->stopping) {
+      pthread_cond_wait(&pool->hasWork, &pool->lock);
+    }
+    if (pool->head == NULL) {
+      break;
+    }
+    task *next = pool->head;
+    pool->head = next->next;
+    if (pool->head == NULL) {
+      pool->tail = NULL;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    next->function(next->argument);
+    free(next);
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->pending == 0) {
+      pthread_cond_broadcast(&pool->idle);
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+/**
+ Create a pool of worker threads
+ @param threadCount is the number of workers, at least 1
+ @return A pointer to the new pool, or NULL on failure
+ */
+threadPool *createThreadPool(int threadCount) {
+  threadPool *pool = malloc(sizeof(threadPool));
+  if (pool == NULL) {
+    return NULL;
+  }
+  pool->threads = malloc(sizeof(pthread_t) * threadCount);
+  if (pool->threads == NULL) {
+    free(pool);
+    return NULL;
+  }
+  pool->threadCount = 0;
+  pool->head = NULL;
+  pool->tail = NULL;
+  pool->pending = 0;
+  pool->stopping = 0;
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->hasWork, NULL);
+  pthread_cond_init(&pool->idle, NULL);
+  for (int i = 0; i < threadCount; i++) {
+    if (pthread_create(&pool->threads[i], NULL, worker, pool) != 0) {
+      destroyThreadPool(pool);
+      return NULL;
+    }
+    pool->threadCount++;
+  }
+  return pool;
+}
+
+/**
+ Queue a task to run on one of the workers. If there is no memory to queue
+ it, the task runs on the calling thread instead.
+ @param pool is the pool to run on
+ @param function is the function to call
+ @param argument is passed to function
+ */
+void submitTask(threadPool *pool, void (*function)(void *), void *argument) {
+  task *newTask = malloc(sizeof(task));
+  if (newTask == NULL) {
+    function(argument);
+    return;
+  }
+  newTask->function = function;
+  newTask->argument = argument;
+  newTask->next = NULL;
+  pthread_mutex_lock(&pool->lock);
+  if (pool->tail == NULL) {
+    pool->head = newTask;
+  } else {
+    pool->tail->next = newTask;
+  }
+  pool->tail = newTask;
+  pool->pending++;
+  pthread_cond_signal(&pool->hasWork);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ Block until every submitted task has finished
+ @param pool is the pool to wait for
+ */
+void waitForTasks(threadPool *pool) {
+  pthread_mutex_lock(&pool->lock);
+  while (pool->pending > 0) {
+    pthread_cond_wait(&pool->idle, &pool->lock);
+  }
+  pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ Finish the queued tasks, stop the workers and free the pool
+ @param pool is the pool to destroy
+ */
+void destroyThreadPool(threadPool *pool) {
+  pthread_mutex_lock(&pool->lock);
+  pool->stopping = 1;
+  pthread_cond_broadcast(&pool->hasWork);
+  pthread_mutex_unlock(&pool->lock);
+  for (int i = 0; i < pool->threadCount; i++) {
+    pthread_join(pool->threads[i], NULL);
+  }
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->hasWork);
+  pthread_cond_destroy(&pool->idle);
+  free(pool->threads);
+  free(pool);
+}
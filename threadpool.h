@@ -0,0 +1,75 @@
+/**
+        @file
+        @author Francis Nguyen <fn87@drexel.edu>
+        @date 2024
+        @section DESCRIPTION
+
+        This file contains the interface for a fixed size pool of worker
+        threads that run submitted tasks in first in, first out order.
+
+*/
+
+#ifndef _THREADPOOL_H_
+#define _THREADPOOL_H_
+
+#include <pthread.h>
+
+/**
+A queued call of task(argument)
+*/
+typedef struct Task {
+  void (*function)(void *); /**< Function to run */
+  void *argument;           /**< Argument to pass to function */
+  struct Task *next;        /**< Next task in the queue */
+} task;
+
+/**
+Worker threads and the queue they take tasks from
+*/
+typedef struct ThreadPool {
+  pthread_t *threads;     /**< The workers */
+  int threadCount;        /**< Number of workers */
+  task *head;             /**< Next task to run */
+  task *tail;             /**< Last task submitted */
+  int pending;            /**< Tasks submitted but not finished */
+  int stopping;           /**< Set when the pool is being destroyed */
+  pthread_mutex_t lock;   /**< Protects every field above */
+  pthread_cond_t hasWork; /**< Signalled when a task is queued */
+  pthread_cond_t idle;    /**< Signalled when pending drops to 0 */
+} threadPool;
+
+/**
+ Number of processors available to this process
+ @return a positive number of processors
+ */
+int processorCount(void);
+
+/**
+ Create a pool of worker threads
+ @param threadCount is the number of workers, at least 1
+ @return A pointer to the new pool, or NULL on failure
+ */
+threadPool *createThreadPool(int threadCount);
+
+/**
+ Queue a task to run on one of the workers. If there is no memory to queue
+ it, the task runs on the calling thread instead.
+ @param pool is the pool to run on
+ @param function is the function to call
+ @param argument is passed to function
+ */
+void submitTask(threadPool *pool, void (*function)(void *), void *argument);
+
+/**
+ Block until every submitted task has finished
+ @param pool is the pool to wait for
+ */
+void waitForTasks(threadPool *pool);
+
+/**
+ Finish the queued tasks, stop the workers and free the pool
+ @param pool is the pool to destroy
+ */
+void destroyThreadPool(threadPool *pool);
+
+#endif